@@ -0,0 +1,66 @@
+/*
+**
+** Copyright (C) 2015 Aldebaran Robotics
+** See COPYING for the license
+*/
+
+#ifndef _JAVA_JNI_ADMISSIONCONTROL_HPP_
+#define _JAVA_JNI_ADMISSIONCONTROL_HPP_
+
+#include <deque>
+#include <vector>
+#include <string>
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+#include <qi/clock.hpp>
+
+namespace qi
+{
+  /**
+   * @brief The AdmissionControl class Bounds Java calls of a service.
+   * At most maxConcurrent calls run at once, others wait in a queue of at
+   * most maxQueued calls. A call that waited more than maxQueueDelay when its
+   * turn comes is shed instead of run: under overload, callers get an error
+   * quickly rather than a late result.
+   */
+  class AdmissionControl
+  {
+    public:
+      /// Start a call, return false if it could not be queued to run.
+      typedef boost::function<bool ()> Start;
+      /// Fail a call that will never run with given reason.
+      typedef boost::function<void (const std::string&)> Reject;
+
+      AdmissionControl();
+
+      /// Null limits mean no limit.
+      void setLimits(unsigned int maxConcurrent, unsigned int maxQueued, qi::MilliSeconds maxQueueDelay);
+
+      /// Start call now if there is room, queue it or reject it otherwise.
+      void submit(const Start& start, const Reject& reject);
+      /// Release room of a started call, must be called once it is done.
+      void finish();
+
+    private:
+      struct Pending
+      {
+        Start                 start;
+        Reject                reject;
+        qi::SteadyClock::time_point queued;
+      };
+      typedef std::vector<std::pair<Reject, std::string> > Rejections;
+
+      bool expired(const Pending& pending, const qi::SteadyClock::time_point& now) const;
+      void startCall(Start start, Reject reject);
+
+      boost::mutex                 _mutex;
+      std::deque<Pending>          _pending;
+      unsigned int                 _running;
+      unsigned int                 _maxConcurrent;
+      unsigned int                 _maxQueued;
+      qi::MilliSeconds             _maxQueueDelay;
+  };
+
+} // !qi
+
+#endif // !_JAVA_JNI_ADMISSIONCONTROL_HPP_
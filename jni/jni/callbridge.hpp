@@ -11,26 +11,122 @@
 #define _JAVA_JNI_CALLBRIDGE_HPP_
 
 #include <list>
+#include <vector>
+#include <deque>
 #include <jni.h>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include <jnitools.hpp>
+#include <javaexecutor.hpp>
+#include <memocache.hpp>
+#include <admissioncontrol.hpp>
+#include <callgate.hpp>
 
-// Generic callback for call forward
-qi::Future<qi::AnyValue>*    call_from_java(JNIEnv *env, qi::AnyObject object, const std::string& strMethodName, jobjectArray listParams);
+// Generic callback for call forward, a Java exception is thrown if call cannot be made
+qi::Future<qi::AnyValue>     call_from_java(JNIEnv *env, qi::AnyObject object, const std::string& strMethodName, jobjectArray listParams);
+qi::Future<qi::AnyValue>     call_from_java(JNIEnv *env, qi::AnyObject object, const std::string& strMethodName, const qi::GenericFunctionParameters& params);
+qi::Future<qi::AnyValue>     call_qi_method(qi::AnyObject object, const std::string& strMethodName, const qi::GenericFunctionParameters& params);
+void                         java_call_parameters(JNIEnv* env, jobjectArray listParams, std::vector<jobject>& objs, qi::GenericFunctionParameters& params);
 qi::AnyReference                 call_to_java(std::string signature, void* data, const qi::GenericFunctionParameters& params);
 qi::AnyReference                 event_callback_to_java(void *vinfo, const std::vector<qi::AnyReference>& params);
+/// Future of call failing with a timeout error if call is not finished after timeout, call is then canceled.
+qi::Future<qi::AnyValue>         call_with_deadline(qi::Future<qi::AnyValue> call, qi::MilliSeconds timeout);
+
+struct qi_method_info;
+/// Resolve Java implementation of info->sig, return false if there is none yet.
+bool                             prepare_java_method(JNIEnv* env, qi_method_info* info);
+/// Deliver calls of info in batches to handler method of its instance, return false if there is no such handler.
+bool                             prepare_java_batch(JNIEnv* env, qi_method_info* info, const std::string& handler, unsigned int maxBatchSize);
+
+/**
+ * @brief The qi_service_info struct Settings shared by all methods of an object built by a DynamicObjectBuilder.
+ */
+struct qi_service_info
+{
+  boost::shared_ptr<qi::JavaExecutor> executor; // Runs Java calls if set, event loop threads otherwise
+  boost::shared_ptr<qi::AdmissionControl> admission; // Bounds running and queued Java calls if set
+  boost::shared_ptr<qi::CallGate>     gate; // Orders exclusive and strand calls
+  bool                                threadSafe; // Object advertised as MultiThread
+  bool                                nativeLocking; // Object is MultiThread for qimessaging, calls are ordered by gate
+
+  qi_service_info()
+    : gate(new qi::CallGate())
+    , threadSafe(false)
+    , nativeLocking(false)
+  {
+  }
+};
+
+/**
+ * @brief The qi_batch_info struct Calls of a batched method waiting to be delivered to its Java batch handler.
+ */
+struct qi_batch_info
+{
+  typedef std::pair<qi::GenericFunctionParameters, qi::Promise<qi::AnyValue> > Call;
+
+  jmethodID         handler; // Object[] handler(Object[][] calls), or void handler(Object[][] calls)
+  bool              returnsResults;
+  unsigned int      maxBatchSize; // 0 delivers all pending calls at once
+  boost::mutex      mutex;
+  std::deque<Call>  pending; // Owned copies of call parameters
+  bool              scheduled; // A delivery task is queued or running
+
+  qi_batch_info()
+    : handler(0)
+    , returnsResults(false)
+    , maxBatchSize(0)
+    , scheduled(false)
+  {
+  }
+};
+
+/// Concurrency of a method with the other methods of its object, as com.aldebaran.qi.MethodOptions.Concurrency
+enum JavaConcurrency
+{
+  JavaConcurrency_Default = -1, // Exclusive for a SingleThread object, concurrent otherwise
+  JavaConcurrency_Concurrent = 0, // Runs in parallel with any non exclusive call
+  JavaConcurrency_Exclusive = 1, // Runs alone
+  JavaConcurrency_Strand = 2 // Concurrent, but serialized with calls having the same key argument
+};
+
+/// How the Java implementation of a method is called.
+enum JavaMethodKind
+{
+  JavaMethod_Boxed, // Parameters and result as Java objects
+  JavaMethod_Unboxed, // Primitive parameters and result, as (IF)V
+  JavaMethod_Future // Parameters as Java objects, result given by a returned com.aldebaran.qi.Future
+};
 
 struct qi_method_info
 {
   jobject     instance; // QimessagingService implementation instance
   std::string sig; // Complete signature
   jobject     jobj; // GenericObject Java instance
+  boost::shared_ptr<qi_service_info> service; // Object settings, empty for event callbacks
+  boost::shared_ptr<qi::MemoCache> memo; // Results served without calling Java, if method is memoized
+  jmethodID   mid; // Java implementation, resolved by prepare_java_method
+  JavaMethodKind kind;
+  bool        cancellable; // Run asynchronously, cancel requests are visible to Java through QiContext
+  int         concurrency; // JavaConcurrency
+  unsigned int strandKey; // Index of the key argument of a strand method
+  qi::MilliSeconds deadline; // Calls fail if not finished in time, 0 for no deadline
+  boost::shared_ptr<qi_batch_info> batch; // Calls delivered in batches, if set
 
-  qi_method_info(jobject jinstance, const std::string& jsig, jobject object)
+  qi_method_info(jobject jinstance, const std::string& jsig, jobject object,
+                 boost::shared_ptr<qi_service_info> serviceInfo = boost::shared_ptr<qi_service_info>())
   {
     instance = jinstance;
     sig = jsig;
     jobj = object;
+    service = serviceInfo;
+    mid = 0;
+    kind = JavaMethod_Boxed;
+    cancellable = false;
+    concurrency = JavaConcurrency_Default;
+    strandKey = 0;
+    deadline = qi::MilliSeconds(0);
   }
 
   ~qi_method_info()
@@ -45,10 +141,42 @@ struct qi_method_info
   }
 };
 
+/**
+ * @brief The qi_signal_fanout struct Java listeners sharing one subscription to a signal of an object.
+ * Each event is converted to Java objects once, then given to all listeners in a single attached pass.
+ * Events of a prioritized subscription are delivered one at a time, in emission order.
+ */
+struct qi_signal_fanout
+{
+  boost::mutex                  mutex;
+  std::vector<boost::shared_ptr<qi_method_info> > listeners;
+  qi::AnyObject                 object; // Object the link belongs to, kept until it is disconnected
+  qi::SignalLink                link;
+  int                           lane; // Dispatcher lane of listeners, -1 to call them in emitting thread
+  std::deque<qi::GenericFunctionParameters> pending; // Owned copies of events waiting for the dispatcher
+  bool                          scheduled; // A delivery task is queued or running
+
+  qi_signal_fanout()
+    : link(qi::SignalBase::invalidSignalLink)
+    , lane(-1)
+    , scheduled(false)
+  {
+  }
+
+  ~qi_signal_fanout()
+  {
+    for (std::deque<qi::GenericFunctionParameters>::iterator it = pending.begin(); it != pending.end(); ++it)
+      it->destroy();
+  }
+};
+
+/// Generic callback of a shared signal subscription.
+qi::AnyReference                 event_fanout_to_java(boost::weak_ptr<qi_signal_fanout> fanout, const std::vector<qi::AnyReference>& params);
+
 /**
  * @brief The MethodInfoHandler class
- * Singleton holding all qi_method_info instances.
- * Entries are added whenever  Object.connect() or DynamicObjectBuilder.advertiseMethod is called.
+ * Singleton holding qi_method_info instances of service methods and session callbacks.
+ * Entries are added whenever Session.onDisconnected() or DynamicObjectBuilder.advertiseMethod is called.
  * Entries are deleted when the com.aldebaran.qimessaging.Object is collected.
  */
 class MethodInfoHandler
@@ -0,0 +1,70 @@
+/*
+**
+** Copyright (C) 2015 Aldebaran Robotics
+** See COPYING for the license
+*/
+
+#ifndef _JAVA_JNI_CALLGATE_HPP_
+#define _JAVA_JNI_CALLGATE_HPP_
+
+#include <deque>
+#include <map>
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/thread/mutex.hpp>
+#include <qi/anyvalue.hpp>
+
+namespace qi
+{
+  /**
+   * @brief The CallGate class Starts calls of a Java service according to their concurrency,
+   * without blocking any thread.
+   * Exclusive calls run alone. Other calls run in parallel, except calls of a strand
+   * with equal keys, which run one after the other. Calls that cannot start yet wait
+   * in submission order, and are queued on their thread when their turn comes.
+   */
+  class CallGate : public boost::enable_shared_from_this<CallGate>
+  {
+    public:
+      typedef boost::function<void ()> Task;
+      /// Queue task on the thread that will run it, return false if it cannot be queued.
+      typedef boost::function<bool (const Task&)> Post;
+
+      CallGate();
+
+      /**
+       * Run task through post once its concurrency allows it.
+       * @param key strand key of the call, null if it is not part of a strand
+       * @param drop called instead of task if post fails
+       */
+      void submit(bool exclusive, const qi::AnyValue* key, const Task& task, const Post& post, const Task& drop);
+
+    private:
+      struct Call
+      {
+        Task         task;
+        Post         post;
+        Task         drop;
+        bool         exclusive;
+        bool         strand;
+        qi::AnyValue key;
+      };
+      typedef std::vector<Call> Calls;
+
+      bool canRun(bool exclusive) const;
+      void admit(const Call& call, Calls& ready);
+      void start(const Calls& ready);
+      void run(const Call& call);
+      void finish(const Call& call);
+
+      boost::mutex                        _mutex;
+      std::deque<Call>                    _waiting; // Calls waiting for running ones, oldest first
+      std::map<qi::AnyValue, std::deque<Call> > _strands; // Keys of strand calls in flight, with calls waiting for them
+      unsigned int                        _running; // Non exclusive calls running
+      bool                                _exclusive; // An exclusive call is running
+  };
+
+} // !qi
+
+#endif // !_JAVA_JNI_CALLGATE_HPP_
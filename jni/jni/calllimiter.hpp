@@ -0,0 +1,91 @@
+/*
+**
+** Copyright (C) 2015 Aldebaran Robotics
+** See COPYING for the license
+*/
+
+#ifndef _JAVA_JNI_CALLLIMITER_HPP_
+#define _JAVA_JNI_CALLLIMITER_HPP_
+
+#include <map>
+#include <jni.h>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <qi/anyvalue.hpp>
+#include <qi/future.hpp>
+
+namespace qi
+{
+  /**
+   * @brief The CallLimiter class Bounds calls in flight of a proxy or a session.
+   * Each admitted call is tracked until its promise is finished.
+   */
+  class CallLimiter
+  {
+    public:
+      /// What to do with a call beyond limits, as com.aldebaran.qi.OverflowPolicy
+      enum Overflow
+      {
+        Overflow_Block = 0, // Wait for room
+        Overflow_FailFast = 1, // Reject new call
+        Overflow_DropOldest = 2 // Fail oldest calls in flight to make room
+      };
+
+      struct Counters
+      {
+        unsigned int inFlight;
+        size_t       bytes;
+        qi::uint64_t rejected;
+        qi::uint64_t dropped;
+      };
+
+      CallLimiter();
+
+      /// Null maxInFlight or maxBytes means no limit.
+      void setLimits(unsigned int maxInFlight, size_t maxBytes, Overflow overflow);
+      bool limitsBytes();
+
+      /// Stop a dropped call, once its promise is failed.
+      typedef boost::function<void ()> Stop;
+
+      /**
+       * Track a call of given size completing promise.
+       * Return 0 if call is rejected, a ticket to give to finish otherwise.
+       */
+      qi::uint64_t admit(size_t bytes, qi::Promise<qi::AnyValue> promise, const Stop& stop);
+      void finish(qi::uint64_t ticket);
+      Counters counters();
+
+    private:
+      struct Call
+      {
+        size_t                    bytes;
+        qi::Promise<qi::AnyValue> promise;
+        Stop                      stop;
+      };
+
+      bool hasRoom(size_t bytes) const;
+
+      boost::mutex                     _mutex;
+      boost::condition_variable        _cond;
+      std::map<qi::uint64_t, Call>     _calls; // oldest call first
+      qi::uint64_t                     _nextTicket;
+      unsigned int                     _maxInFlight;
+      size_t                           _maxBytes;
+      Overflow                         _overflow;
+      size_t                           _bytes;
+      qi::uint64_t                     _rejected;
+      qi::uint64_t                     _dropped;
+  };
+
+} // !qi
+
+/**
+ * @brief java_call_counters Counters of limiter as a Java long[] {inFlight, bytes, rejected, dropped}.
+ * All counters are null if there is no limiter.
+ */
+jlongArray java_call_counters(JNIEnv* env, boost::shared_ptr<qi::CallLimiter> limiter);
+
+#endif // !_JAVA_JNI_CALLLIMITER_HPP_
@@ -0,0 +1,81 @@
+/*
+**
+** Copyright (C) 2015 Aldebaran Robotics
+** See COPYING for the license
+*/
+
+#ifndef _JAVA_JNI_COMPLETIONQUEUE_HPP_
+#define _JAVA_JNI_COMPLETIONQUEUE_HPP_
+
+#include <deque>
+#include <jni.h>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/unordered_set.hpp>
+#include <qi/anyvalue.hpp>
+#include <qi/clock.hpp>
+#include <qi/future.hpp>
+
+namespace qi
+{
+  /**
+   * @brief The CompletionQueue class Tags of finished futures, drained by Java in batches.
+   * Futures push their tag natively when they finish, no Java code runs then.
+   * Finished futures are kept by tag until taken.
+   */
+  class CompletionQueue
+  {
+    public:
+      CompletionQueue();
+      ~CompletionQueue();
+
+      /// Wake up threads waiting in drain, further drains return at once.
+      void close();
+
+      /// Push tag once future is finished, false if tag is already used by a future not taken yet.
+      bool add(qi::Future<qi::AnyValue> future, jlong tag);
+      /**
+       * Copy up to max tags of finished futures, oldest first.
+       * Wait up to timeout for the first one if there is none, forever if timeout is negative.
+       * Return the number of tags copied.
+       */
+      int  drain(jlong* tags, int max, qi::MilliSeconds timeout);
+      /// Finished future of tag, false if there is none.
+      bool take(jlong tag, qi::Future<qi::AnyValue>& future);
+
+    private:
+      struct State
+      {
+        boost::mutex                   mutex;
+        boost::condition_variable      cond;
+        std::deque<jlong>              finished;
+        boost::unordered_map<jlong, qi::Future<qi::AnyValue> > results;
+        boost::unordered_set<jlong>    tags; // Added and not taken yet
+        bool                           closed;
+
+        State()
+          : closed(false)
+        {
+        }
+      };
+
+      static void push(boost::weak_ptr<State> weakState, jlong tag, qi::Future<qi::AnyValue> future);
+
+      // Shared with drain callers, continuations of pending futures only hold a weak reference.
+      boost::shared_ptr<State> _state;
+  };
+} // !qi
+
+extern "C"
+{
+  JNIEXPORT jlong   Java_com_aldebaran_qi_CompletionQueue_create(JNIEnv* env, jclass cls);
+  JNIEXPORT void    Java_com_aldebaran_qi_CompletionQueue_destroy(JNIEnv* env, jclass cls, jlong pQueue);
+  JNIEXPORT void    Java_com_aldebaran_qi_CompletionQueue_add(JNIEnv* env, jclass cls, jlong pQueue, jlong pFuture, jlong tag);
+  JNIEXPORT jint    Java_com_aldebaran_qi_CompletionQueue_drain(JNIEnv* env, jclass cls, jlong pQueue, jlongArray tags, jint max, jlong timeoutMs);
+  JNIEXPORT jobject Java_com_aldebaran_qi_CompletionQueue_take(JNIEnv* env, jclass cls, jlong pQueue, jlong tag);
+} // !extern "C"
+
+#endif // !_JAVA_JNI_COMPLETIONQUEUE_HPP_
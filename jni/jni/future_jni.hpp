@@ -12,8 +12,14 @@
 
 #include <jni.h>
 #include <qi/future.hpp>
+#include <qi/anyvalue.hpp>
 
-//jobject   newJavaFuture(qi::Future<qi::AnyValue> *fut);
+/// Handle of future for a com.aldebaran.qi.Future, released by Future.close() or when it is collected.
+jlong java_future_handle(const qi::Future<qi::AnyValue>& future);
+/// Future of a handle, false if the handle is closed.
+bool  java_future_from_handle(jlong handle, qi::Future<qi::AnyValue>& future);
+/// Future held by a com.aldebaran.qi.Future, false if it is null or closed.
+bool  java_future(JNIEnv* env, jobject future, qi::Future<qi::AnyValue>& result);
 
 extern "C"
 {
@@ -22,9 +28,16 @@ extern "C"
   JNIEXPORT jobject  Java_com_aldebaran_qi_Future_qiFutureCallGetWithTimeout(JNIEnv *env, jobject obj, jlong pFuture, jint timeout);
   JNIEXPORT jboolean Java_com_aldebaran_qi_Future_qiFutureCallIsCancelled(JNIEnv *env, jobject obj, jlong pFuture);
   JNIEXPORT jboolean Java_com_aldebaran_qi_Future_qiFutureCallIsDone(JNIEnv *env, jobject obj, jlong pFuture);
-  JNIEXPORT jboolean Java_com_aldebaran_qi_Future_qiFutureCallConnect(JNIEnv *env, jobject obj, jlong pFuture, jobject callable, jstring className, jobjectArray args);
+  JNIEXPORT jboolean Java_com_aldebaran_qi_Future_qiFutureCallConnect(JNIEnv *env, jobject obj, jlong pFuture, jobject callable, jstring className, jobjectArray args, jint lane);
   JNIEXPORT void     Java_com_aldebaran_qi_Future_qiFutureCallWaitWithTimeout(JNIEnv *env, jobject obj, jlong pFuture, jint timeout);
+  JNIEXPORT jlong    Java_com_aldebaran_qi_Future_qiFutureThen(JNIEnv* env, jclass cls, jlong pFuture, jobject function, jboolean withValue, jint lane);
+  JNIEXPORT void     Java_com_aldebaran_qi_Future_qiFutureCallComplete(JNIEnv* env, jclass cls, jlong pFuture, jobject adapter, jint lane);
+  JNIEXPORT jlong    Java_com_aldebaran_qi_Future_qiFutureWhenAll(JNIEnv* env, jclass cls, jlongArray pFutures);
+  JNIEXPORT jlong    Java_com_aldebaran_qi_Future_qiFutureWhenAny(JNIEnv* env, jclass cls, jlongArray pFutures);
+  JNIEXPORT jboolean Java_com_aldebaran_qi_Future_qiFutureWaitAll(JNIEnv* env, jclass cls, jlongArray pFutures, jint timeout);
+  JNIEXPORT jint     Java_com_aldebaran_qi_Future_qiFutureWaitAny(JNIEnv* env, jclass cls, jlongArray pFutures, jint timeout);
   JNIEXPORT void     Java_com_aldebaran_qi_Future_qiFutureDestroy(JNIEnv* QI_UNUSED(env), jobject QI_UNUSED(obj), jlong pFuture);
+  JNIEXPORT jboolean Java_com_aldebaran_qi_Future_qiFutureIsValid(JNIEnv* env, jclass cls, jlong pFuture);
 } // !extern "C"
 
 #endif //!_FUTURE_JNI_HPP_
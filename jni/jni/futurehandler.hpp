@@ -20,41 +20,53 @@
 namespace qi
 {
   /**
-   * @brief The CallbackInfo struct Container used by FutureHandler
+   * @brief The CallbackInfo struct Java callback of a future, bound to the future continuation.
+   * Methods are resolved once, when the callback is connected.
    */
   struct CallbackInfo
   {
     jobject      instance;
     jobjectArray args;
     std::string  className;
-    std::string  interfaceName;
+    jmethodID    onSuccess;
+    jmethodID    onFailure;
+    jmethodID    onComplete;
 
-    CallbackInfo(jobject instance, jobjectArray args, const std::string& className, const std::string& interfaceName = "com/aldebaran/qi/Callback")
+    CallbackInfo(JNIEnv* env, jobject instance, jobjectArray args, const std::string& className)
     {
-      JNIEnv* env = 0;
-      JVM()->GetEnv((void**) &env, QI_JNI_MIN_VERSION);
-
       // We need to get global reference on each object of array to use them in callback thread.
       jint size = env->GetArrayLength(args);
-      jobjectArray array = (jobjectArray) env->NewGlobalRef(env->NewObjectArray(size, env->FindClass("java/lang/Object"), 0));
+      jclass objectClass = env->FindClass("java/lang/Object");
+      jobjectArray array = env->NewObjectArray(size, objectClass, 0);
       jint i = 0;
       while (i < size)
       {
         jobject current = env->GetObjectArrayElement(args, i);
         env->SetObjectArrayElement(array, i, env->NewGlobalRef(current));
+        env->DeleteLocalRef(current);
         i++;
       }
+      env->DeleteLocalRef(objectClass);
 
       this->instance = env->NewGlobalRef(instance);
-      this->args = array;
+      this->args = (jobjectArray) env->NewGlobalRef(array);
+      env->DeleteLocalRef(array);
       this->className = className;
-      this->interfaceName = interfaceName;
+
+      jclass cls = env->GetObjectClass(instance);
+      this->onSuccess = env->GetMethodID(cls, "onSuccess", "(Lcom/aldebaran/qi/Future;[Ljava/lang/Object;)V");
+      this->onFailure = env->GetMethodID(cls, "onFailure", "(Lcom/aldebaran/qi/Future;[Ljava/lang/Object;)V");
+      this->onComplete = env->GetMethodID(cls, "onComplete", "(Lcom/aldebaran/qi/Future;[Ljava/lang/Object;)V");
+      if (env->ExceptionCheck())
+        env->ExceptionClear();
+      env->DeleteLocalRef(cls);
     }
 
     ~CallbackInfo()
     {
-      JNIEnv* env = 0;
-      JVM()->GetEnv((void**) &env, QI_JNI_MIN_VERSION);
+      // May be destroyed in a qimessaging thread
+      qi::jni::JNIAttach attach;
+      JNIEnv* env = attach.get();
 
       // Destroy all global reference on arguments array
       jint size = env->GetArrayLength(this->args);
@@ -63,6 +75,7 @@ namespace qi
       {
         jobject current = env->GetObjectArrayElement(this->args, i);
         env->DeleteGlobalRef(current);
+        env->DeleteLocalRef(current);
         i++;
       }
 
@@ -77,16 +90,16 @@ namespace qi
   class FutureHandler
   {
     public:
-      static void onSuccess(JNIEnv *env, jclass cls, qi::CallbackInfo *info);
-      static void onFailure(JNIEnv *env, jclass cls, qi::CallbackInfo *info);
-      static void onComplete(JNIEnv *env, jclass cls, qi::CallbackInfo *info);
-      static qi::CallbackInfo* methodInfo(const qi::Future<qi::AnyValue> &future);
-      static void addCallbackInfo(qi::Future<AnyValue>* future, qi::CallbackInfo* info);
-      static void removeCallbackInfo(const qi::Future<qi::AnyValue>& future);
-      static jobject futurePointer(JNIEnv* env, qi::CallbackInfo* info);
+      /// Resolve com.aldebaran.qi.Future class, must be called from a Java thread.
+      static void init(JNIEnv* env);
+      static void onSuccess(JNIEnv *env, const qi::Future<qi::AnyValue>& future, qi::CallbackInfo *info);
+      static void onFailure(JNIEnv *env, const qi::Future<qi::AnyValue>& future, qi::CallbackInfo *info);
+      static void onComplete(JNIEnv *env, const qi::Future<qi::AnyValue>& future, qi::CallbackInfo *info);
+      /// New com.aldebaran.qi.Future holding a copy of future.
+      static jobject futurePointer(JNIEnv* env, const qi::Future<qi::AnyValue>& future);
 
-    public:
-      std::map<qi::Future<qi::AnyValue>*, qi::CallbackInfo*> _map;
+    private:
+      static void call(JNIEnv *env, jmethodID method, const char* name, const qi::Future<qi::AnyValue>& future, qi::CallbackInfo *info);
   };
 
 } // !qi
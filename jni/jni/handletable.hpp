@@ -0,0 +1,145 @@
+/*
+**
+** Copyright (C) 2015 Aldebaran Robotics
+** See COPYING for the license
+*/
+
+#ifndef _JAVA_JNI_HANDLETABLE_HPP_
+#define _JAVA_JNI_HANDLETABLE_HPP_
+
+#include <vector>
+#include <jni.h>
+#include <boost/thread/mutex.hpp>
+#include <qi/types.hpp>
+
+namespace qi
+{
+  /**
+   * @brief The HandleTable class Native objects given to Java as handles instead of raw pointers.
+   * Objects are stored by value in slabs that never move, and free slots are reused.
+   * A handle holds the slot index and its generation, bumped when the object is removed:
+   * a stale handle, released twice or used after release, is detected instead of
+   * touching freed memory.
+   */
+  template <typename T>
+  class HandleTable
+  {
+    public:
+      HandleTable()
+        : _size(0)
+      {
+      }
+
+      ~HandleTable()
+      {
+        for (typename std::vector<Slot*>::iterator it = _slabs.begin(); it != _slabs.end(); ++it)
+          delete[] *it;
+      }
+
+      /// Store a copy of object, return its handle, never 0.
+      jlong add(const T& object)
+      {
+        boost::mutex::scoped_lock lock(_mutex);
+        qi::uint32_t index;
+
+        if (!_free.empty())
+        {
+          index = _free.back();
+          _free.pop_back();
+        }
+        else
+        {
+          if (_size == _slabs.size() * SlabSize)
+            _slabs.push_back(new Slot[SlabSize]);
+          index = _size++;
+        }
+
+        Slot& s = slot(index);
+        s.object = object;
+        s.used = true;
+        return (jlong) (((qi::uint64_t) s.generation << 32) | (index + 1));
+      }
+
+      /// Copy object of handle, return false if handle is stale.
+      bool get(jlong handle, T& object)
+      {
+        boost::mutex::scoped_lock lock(_mutex);
+        Slot* s = find(handle);
+
+        if (!s)
+          return false;
+        object = s->object;
+        return true;
+      }
+
+      /// Release object of handle, return false if handle is stale.
+      bool remove(jlong handle)
+      {
+        T object;
+        {
+          boost::mutex::scoped_lock lock(_mutex);
+          Slot* s = find(handle);
+
+          if (!s)
+            return false;
+          // Destroyed out of lock: it may be the last reference on a shared state.
+          object = s->object;
+          s->object = T();
+          s->used = false;
+          ++s->generation;
+          _free.push_back((qi::uint32_t) (((qi::uint64_t) handle & 0xffffffff) - 1));
+        }
+        return true;
+      }
+
+      /// Number of live handles.
+      size_t size()
+      {
+        boost::mutex::scoped_lock lock(_mutex);
+        return _size - _free.size();
+      }
+
+    private:
+      enum { SlabSize = 256 };
+
+      struct Slot
+      {
+        T            object;
+        qi::uint32_t generation;
+        bool         used;
+
+        Slot()
+          : generation(1)
+          , used(false)
+        {
+        }
+      };
+
+      Slot& slot(qi::uint32_t index)
+      {
+        return _slabs[index / SlabSize][index % SlabSize];
+      }
+
+      Slot* find(jlong handle)
+      {
+        qi::uint64_t value = (qi::uint64_t) handle;
+        qi::uint32_t index = (qi::uint32_t) (value & 0xffffffff);
+
+        if (index == 0 || index > _size)
+          return 0;
+
+        Slot& s = slot(index - 1);
+        if (!s.used || s.generation != (qi::uint32_t) (value >> 32))
+          return 0;
+        return &s;
+      }
+
+      boost::mutex               _mutex;
+      std::vector<Slot*>         _slabs;
+      std::vector<qi::uint32_t>  _free;
+      qi::uint32_t               _size; // Slots used at least once
+  };
+
+} // !qi
+
+#endif // !_JAVA_JNI_HANDLETABLE_HPP_
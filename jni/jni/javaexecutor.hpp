@@ -0,0 +1,56 @@
+/*
+**
+** Copyright (C) 2015 Aldebaran Robotics
+** See COPYING for the license
+*/
+
+#ifndef _JAVA_JNI_JAVAEXECUTOR_HPP_
+#define _JAVA_JNI_JAVAEXECUTOR_HPP_
+
+#include <deque>
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
+
+namespace qi
+{
+  /**
+   * @brief The JavaExecutor class Pool of threads attached to the JVM once for all,
+   * running tasks from bounded queues.
+   * Used to run Java service implementations outside of qimessaging event loop threads,
+   * and to dispatch prioritized callbacks to Java.
+   * Tasks are queued in lanes: a thread always takes the first task of the lowest lane
+   * that is not empty, so lane 0 tasks run first.
+   */
+  class JavaExecutor
+  {
+    public:
+      JavaExecutor(unsigned int threadCount, unsigned int maxQueueSize = 0, unsigned int laneCount = 1);
+      /// Refuse new tasks, wait for queued ones to run.
+      ~JavaExecutor();
+
+      /// Queue task in lane, return false if lane queue is full.
+      bool post(const boost::function<void ()>& task, unsigned int lane = 0);
+      /// Number of tasks waiting for a thread.
+      unsigned int queueSize();
+      /// Number of tasks of lane waiting for a thread.
+      unsigned int laneQueueSize(unsigned int lane);
+      unsigned int laneCount() const;
+
+    private:
+      typedef std::deque<boost::function<void ()> > TaskQueue;
+
+      void run();
+
+      boost::mutex                          _mutex;
+      boost::condition_variable             _cond;
+      std::vector<TaskQueue>                _lanes;
+      unsigned int                          _queued; // Tasks in all lanes
+      std::vector<boost::thread*>           _threads;
+      unsigned int                          _maxQueueSize; // Per lane, 0 means unbounded
+      bool                                  _stopping;
+  };
+
+} // !qi
+
+#endif // !_JAVA_JNI_JAVAEXECUTOR_HPP_
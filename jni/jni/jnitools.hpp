@@ -28,6 +28,13 @@
 #define QI_JNI_MIN_VERSION JNI_VERSION_1_6
 // QI_OBJECT_CLASS defines complete name of java generic object class
 #define QI_OBJECT_CLASS "com/aldebaran/qi/AnyObject"
+// QI_FUTURE_CLASS defines complete name of java future class
+#define QI_FUTURE_CLASS "com/aldebaran/qi/Future"
+// Exceptions thrown for failed calls, all com.aldebaran.qi.CallError subclasses
+#define QI_REMOTE_ERROR_CLASS "com/aldebaran/qi/RemoteError"
+#define QI_TIMEOUT_ERROR_CLASS "com/aldebaran/qi/CallTimeoutError"
+#define QI_CANCELLED_ERROR_CLASS "com/aldebaran/qi/CallCancelledError"
+#define QI_CONVERSION_ERROR_CLASS "com/aldebaran/qi/ConversionError"
 
 // JNI utils
 extern "C"
@@ -66,7 +73,23 @@ namespace qi {
     void        releaseObject(jobject obj);
     // Signature
     std::string javaSignature(const std::string& qiSignature);
-    std::string qiSignature(jclass clazz);
+    std::string qiSignature(JNIEnv* env, jobject object);
+    // Exceptions
+    /// Java exception thrown for a failed call
+    enum CallErrorKind
+    {
+      CallError_Remote,
+      CallError_Timeout,
+      CallError_Cancelled,
+      CallError_Conversion
+    };
+    void          initExceptions(JNIEnv* env);
+    CallErrorKind callErrorKind(const std::string& error);
+    jint          throwCallError(JNIEnv* env, const std::string& error, CallErrorKind kind);
+    /// New exception for a failed call, as a local reference, to give to Java code instead of throwing it.
+    jthrowable    newCallError(JNIEnv* env, const std::string& error, CallErrorKind kind);
+    /// Clear pending Java exception, return its class and message as a qi error.
+    std::string   javaExceptionMessage(JNIEnv* env);
 
   }// !jni
 }// !qi
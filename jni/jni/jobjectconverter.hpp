@@ -13,9 +13,12 @@
 
 #include <jni.h>
 #include <qi/type/typeinterface.hpp>
+#include <qi/anyvalue.hpp>
 
 jobject JObject_from_AnyValue(qi::AnyReference val);
 void JObject_from_AnyValue(qi::AnyReference val, jobject* target);
 std::pair<qi::AnyReference, bool> AnyValue_from_JObject(jobject val);
+/// Copy of value without Java objects, that can be kept and shared without the JVM.
+qi::AnyValue AnyValue_native_copy(const qi::AnyReference& value);
 
 #endif // !_JOBJECTCONVERTER_HPP_
@@ -0,0 +1,55 @@
+/*
+**
+** Copyright (C) 2015 Aldebaran Robotics
+** See COPYING for the license
+*/
+
+#ifndef _JAVA_JNI_MEMOCACHE_HPP_
+#define _JAVA_JNI_MEMOCACHE_HPP_
+
+#include <list>
+#include <string>
+#include <boost/thread/mutex.hpp>
+#include <boost/unordered_map.hpp>
+#include <qi/anyvalue.hpp>
+#include <qi/anyfunction.hpp>
+#include <qi/clock.hpp>
+
+namespace qi
+{
+  /**
+   * @brief The MemoCache class Results of a memoized Java method, keyed by serialized arguments.
+   * Entries expire after ttl, least recently used ones are evicted beyond maxEntries.
+   * Cached values are native: serving them needs no JVM.
+   */
+  class MemoCache
+  {
+    public:
+      MemoCache(qi::MilliSeconds ttl, size_t maxEntries);
+
+      /// Copy cached value of key in value, return false if there is none or if it has expired.
+      bool get(const std::string& key, qi::AnyValue& value);
+      void put(const std::string& key, const qi::AnyValue& value);
+      size_t size();
+
+      static std::string key(const qi::GenericFunctionParameters& params);
+
+    private:
+      struct Entry
+      {
+        std::string                 key;
+        qi::AnyValue                value;
+        qi::SteadyClock::time_point expiry;
+      };
+      typedef std::list<Entry> EntryList;
+
+      boost::mutex _mutex;
+      qi::MilliSeconds _ttl;
+      size_t _maxEntries;
+      EntryList _entries; // most recently used first
+      boost::unordered_map<std::string, EntryList::iterator> _index;
+  };
+
+} // !qi
+
+#endif // !_JAVA_JNI_MEMOCACHE_HPP_
@@ -19,9 +19,22 @@ extern "C"
   JNIEXPORT jlong     Java_com_aldebaran_qi_AnyObject_property(JNIEnv* env, jobject jobj, jlong pObj, jstring name);
   JNIEXPORT jlong     Java_com_aldebaran_qi_AnyObject_setProperty(JNIEnv* env, jobject jobj, jlong pObj, jstring name, jobject property);
   JNIEXPORT jlong     Java_com_aldebaran_qi_AnyObject_asyncCall(JNIEnv* env, jobject jobj, jlong pObj, jstring methodName, jobjectArray args);
+  JNIEXPORT jlong     Java_com_aldebaran_qi_AnyObject_asyncCallWithTimeout(JNIEnv* env, jobject jobj, jlong pObj, jstring methodName, jobjectArray args, jlong timeoutMs);
+  JNIEXPORT jlong     Java_com_aldebaran_qi_AnyObject_asyncCallI(JNIEnv* env, jobject jobj, jlong pObj, jstring methodName, jint a);
+  JNIEXPORT jlong     Java_com_aldebaran_qi_AnyObject_asyncCallF(JNIEnv* env, jobject jobj, jlong pObj, jstring methodName, jfloat a);
+  JNIEXPORT jlong     Java_com_aldebaran_qi_AnyObject_asyncCallB(JNIEnv* env, jobject jobj, jlong pObj, jstring methodName, jboolean a);
+  JNIEXPORT jlong     Java_com_aldebaran_qi_AnyObject_asyncCallS(JNIEnv* env, jobject jobj, jlong pObj, jstring methodName, jstring a);
+  JNIEXPORT jlong     Java_com_aldebaran_qi_AnyObject_asyncCallII(JNIEnv* env, jobject jobj, jlong pObj, jstring methodName, jint a, jint b);
+  JNIEXPORT jlong     Java_com_aldebaran_qi_AnyObject_asyncCallIF(JNIEnv* env, jobject jobj, jlong pObj, jstring methodName, jint a, jfloat b);
+  JNIEXPORT jlong     Java_com_aldebaran_qi_AnyObject_asyncCallFF(JNIEnv* env, jobject jobj, jlong pObj, jstring methodName, jfloat a, jfloat b);
   JNIEXPORT jstring   Java_com_aldebaran_qi_AnyObject_printMetaObject(JNIEnv* env, jobject jobj, jlong pObj);
   JNIEXPORT void      Java_com_aldebaran_qi_AnyObject_destroy(JNIEnv* env, jobject jobj, jlong pObj);
-  JNIEXPORT jlong     Java_com_aldebaran_qi_AnyObject_connect(JNIEnv *env, jobject obj, jlong pObject, jstring method, jobject instance, jstring service, jstring event);
+  JNIEXPORT void      Java_com_aldebaran_qi_AnyObject_setCallCollapsing(JNIEnv* env, jobject jobj, jlong pObj, jstring method, jboolean enabled);
+  JNIEXPORT void      Java_com_aldebaran_qi_AnyObject_setCallCache(JNIEnv* env, jobject jobj, jlong pObj, jstring method, jlong ttlMs, jlong maxBytes);
+  JNIEXPORT void      Java_com_aldebaran_qi_AnyObject_setCacheInvalidationSignal(JNIEnv* env, jobject jobj, jlong pObj, jstring signal);
+  JNIEXPORT void      Java_com_aldebaran_qi_AnyObject_setCallLimits(JNIEnv* env, jobject jobj, jlong pObj, jint maxInFlight, jlong maxBytes, jint overflow);
+  JNIEXPORT jlongArray Java_com_aldebaran_qi_AnyObject_callCounters(JNIEnv* env, jobject jobj, jlong pObj);
+  JNIEXPORT jlong     Java_com_aldebaran_qi_AnyObject_connect(JNIEnv *env, jobject obj, jlong pObject, jstring method, jobject instance, jstring service, jstring event, jint lane);
   JNIEXPORT jlong     Java_com_aldebaran_qi_AnyObject_disconnect(JNIEnv *env, jobject jobj, jlong pObject, jlong subscriberId);
 
   JNIEXPORT void      Java_com_aldebaran_qi_AnyObject_post(JNIEnv *env, jobject obj, jlong pObject, jstring eventName, jobjectArray args);
@@ -0,0 +1,56 @@
+/*
+**
+** Copyright (C) 2015 Aldebaran Robotics
+** See COPYING for the license
+*/
+
+#ifndef _JAVA_JNI_PIPELINE_HPP_
+#define _JAVA_JNI_PIPELINE_HPP_
+
+#include <vector>
+#include <jni.h>
+#include <qi/anyobject.hpp>
+#include <qi/anyvalue.hpp>
+
+namespace qi
+{
+  /**
+   * @brief The CallPipeline class Chain of calls run as future continuations.
+   * A step may take results of previous steps as target object or as
+   * arguments: intermediate results stay native, only the result of the
+   * last step is given to Java.
+   */
+  class CallPipeline
+  {
+    public:
+      struct Step
+      {
+        bool                    property; // Read property method instead of calling it
+        int                     target; // Step whose result is the target object, -1 for object
+        qi::AnyObject           object;
+        std::string             method;
+        std::vector<qi::AnyValue> args;
+        std::vector<int>        refs; // For each argument, step whose result is given instead, -1 for args value
+      };
+
+      /// Add a step, return its index.
+      int add(const Step& step);
+      size_t size() const;
+      /// Run all steps in order, future of the last step result.
+      qi::Future<qi::AnyValue> run() const;
+
+    private:
+      std::vector<Step> _steps;
+  };
+} // !qi
+
+extern "C"
+{
+  JNIEXPORT jlong Java_com_aldebaran_qi_Pipeline_create(JNIEnv* env, jclass cls);
+  JNIEXPORT void  Java_com_aldebaran_qi_Pipeline_destroy(JNIEnv* env, jclass cls, jlong pPipeline);
+  JNIEXPORT jint  Java_com_aldebaran_qi_Pipeline_addCall(JNIEnv* env, jclass cls, jlong pPipeline, jobject object, jint target, jstring method, jobjectArray args);
+  JNIEXPORT jint  Java_com_aldebaran_qi_Pipeline_addProperty(JNIEnv* env, jclass cls, jlong pPipeline, jobject object, jint target, jstring name);
+  JNIEXPORT jlong Java_com_aldebaran_qi_Pipeline_run(JNIEnv* env, jclass cls, jlong pPipeline);
+} // !extern "C"
+
+#endif // !_JAVA_JNI_PIPELINE_HPP_
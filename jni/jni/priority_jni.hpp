@@ -0,0 +1,27 @@
+/*
+**
+** Copyright (C) 2015 Aldebaran Robotics
+** See COPYING for the license
+*/
+
+#ifndef _JAVA_JNI_PRIORITY_HPP_
+#define _JAVA_JNI_PRIORITY_HPP_
+
+#include <jni.h>
+#include <javaexecutor.hpp>
+
+/// Lanes of com.aldebaran.qi.Priority, in ordinal order: High, Normal, Low.
+#define QI_PRIORITY_LANES 3
+
+/**
+ * Pool running prioritized dispatches to Java (signal callbacks, future callbacks).
+ * Created on first use. Lane is the ordinal of a com.aldebaran.qi.Priority.
+ */
+qi::JavaExecutor* java_dispatcher();
+
+extern "C"
+{
+  JNIEXPORT jint Java_com_aldebaran_qi_Priority_queueDepth(JNIEnv* env, jclass cls, jint lane);
+} // !extern "C"
+
+#endif // !_JAVA_JNI_PRIORITY_HPP_
@@ -0,0 +1,21 @@
+/*
+**
+** Copyright (C) 2015 Aldebaran Robotics
+** See COPYING for the license
+*/
+
+#ifndef _JAVA_JNI_PROMISE_HPP_
+#define _JAVA_JNI_PROMISE_HPP_
+
+#include <jni.h>
+
+extern "C"
+{
+  JNIEXPORT jlong    Java_com_aldebaran_qi_Promise_qiPromiseCreate(JNIEnv *env, jclass cls);
+  JNIEXPORT void     Java_com_aldebaran_qi_Promise_qiPromiseDestroy(JNIEnv *env, jclass cls, jlong pPromise);
+  JNIEXPORT jlong    Java_com_aldebaran_qi_Promise_qiPromiseGetFuture(JNIEnv *env, jclass cls, jlong pPromise);
+  JNIEXPORT void     Java_com_aldebaran_qi_Promise_qiPromiseSetValue(JNIEnv *env, jclass cls, jlong pPromise, jobject value);
+  JNIEXPORT void     Java_com_aldebaran_qi_Promise_qiPromiseSetError(JNIEnv *env, jclass cls, jlong pPromise, jstring error);
+} // !extern "C"
+
+#endif // !_JAVA_JNI_PROMISE_HPP_
@@ -0,0 +1,113 @@
+/*
+**
+** Copyright (C) 2015 Aldebaran Robotics
+** See COPYING for the license
+*/
+
+#ifndef _JAVA_JNI_PROXYPOLICY_HPP_
+#define _JAVA_JNI_PROXYPOLICY_HPP_
+
+#include <list>
+#include <map>
+#include <string>
+#include <jni.h>
+#include <qi/anyfunction.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/unordered_map.hpp>
+#include <qi/anyobject.hpp>
+#include <qi/anyvalue.hpp>
+#include <qi/clock.hpp>
+
+#include <calllimiter.hpp>
+
+namespace qi
+{
+  /**
+   * @brief The ProxyPolicy class Client side call settings of a com.aldebaran.qi.AnyObject.
+   * Entries are added when a setting is first changed and removed when the AnyObject is collected.
+   * Objects without settings have no entry: calls go straight to call_from_java.
+ * Proxies given by a session with call limits always have an entry.
+   */
+  class ProxyPolicy
+  {
+    public:
+      ProxyPolicy();
+
+      static boost::shared_ptr<ProxyPolicy> get(qi::AnyObject* object);
+      static boost::shared_ptr<ProxyPolicy> find(qi::AnyObject* object);
+      static void remove(qi::AnyObject* object);
+
+      void setCollapsed(const std::string& method, bool collapsed);
+      /// Cache results of method for ttl, up to maxBytes of encoded values. Null ttl disables cache.
+      void setCache(const std::string& method, qi::MilliSeconds ttl, size_t maxBytes);
+      /// Clear every cached result when signal is triggered on object. Empty signal disables it.
+      void setInvalidationSignal(qi::AnyObject object, const std::string& signal);
+      void clearCache();
+      /// Limits of this proxy, created on first use.
+      boost::shared_ptr<CallLimiter> limiter();
+      /// Limits of this proxy, empty if none were set.
+      boost::shared_ptr<CallLimiter> findLimiter();
+      /// Limits shared by all proxies of the session this proxy comes from.
+      void setSessionLimiter(boost::shared_ptr<CallLimiter> limiter);
+
+      /**
+       * Call method, or share the future of an identical call already in flight
+       * if method is collapsed, or return a finished future if result is cached.
+       * The future fails if a Java exception has been thrown.
+       */
+      qi::Future<qi::AnyValue>  call(JNIEnv* env, qi::AnyObject object, const std::string& method, const qi::GenericFunctionParameters& params);
+
+      /// Key identifying a call: method name and its marshalled arguments.
+      static std::string callKey(const std::string& method, const qi::GenericFunctionParameters& params);
+      /// Method name without signature
+      static std::string methodName(const std::string& method);
+
+    private:
+      /// key is the callKey of the call if already computed, empty otherwise
+      qi::Future<qi::AnyValue>  limitedCall(JNIEnv* env, qi::AnyObject object, const std::string& method, const qi::GenericFunctionParameters& params,
+                                            const std::string& key = std::string());
+
+      struct CacheEntry
+      {
+        qi::AnyValue                          value;
+        qi::SteadyClock::time_point           expiry;
+        size_t                                bytes;
+        std::list<std::string>::iterator      order;
+      };
+
+      struct MethodPolicy
+      {
+        MethodPolicy();
+
+        bool                                  collapsed;
+        qi::MilliSeconds                      ttl;
+        size_t                                maxBytes;
+        size_t                                bytes;
+        boost::unordered_map<std::string, CacheEntry> cache;
+        std::list<std::string>                order; // oldest entry first
+      };
+
+      void store(MethodPolicy& policy, const std::string& key, const qi::AnyValue& value);
+      void erase(MethodPolicy& policy, const std::string& key);
+
+      static void endCall(boost::weak_ptr<ProxyPolicy> policy, const std::string& key);
+      static void storeResult(boost::weak_ptr<ProxyPolicy> policy, const std::string& method, const std::string& key,
+                              qi::uint64_t generation, qi::Future<qi::AnyValue> result);
+      static qi::AnyReference invalidate(boost::weak_ptr<ProxyPolicy> policy, const std::vector<qi::AnyReference>& params);
+
+      boost::mutex _mutex;
+      boost::weak_ptr<ProxyPolicy> _self;
+      std::map<std::string, MethodPolicy> _methods;
+      qi::uint64_t _cacheGeneration; // Incremented each time cache is cleared, results of older calls are not stored
+      boost::unordered_map<std::string, qi::Future<qi::AnyValue> > _inflight;
+      qi::SignalLink _invalidationLink;
+      qi::AnyObject _invalidationObject;
+      boost::shared_ptr<CallLimiter> _limiter;
+      boost::shared_ptr<CallLimiter> _sessionLimiter;
+  };
+
+} // !qi
+
+#endif // !_JAVA_JNI_PROXYPOLICY_HPP_
@@ -0,0 +1,49 @@
+/*
+**
+** Copyright (C) 2015 Aldebaran Robotics
+** See COPYING for the license
+*/
+
+#ifndef _JAVA_JNI_QICONTEXT_HPP_
+#define _JAVA_JNI_QICONTEXT_HPP_
+
+#include <jni.h>
+#include <boost/shared_ptr.hpp>
+#include <qi/atomic.hpp>
+
+namespace qi
+{
+  namespace jni
+  {
+    /**
+     * @brief The CallContext struct State of a cancellable Java method invocation,
+     * shared between the thread running it and the promise of the call.
+     */
+    struct CallContext
+    {
+      qi::Atomic<int> cancelRequested;
+    };
+
+    /**
+     * @brief The CallContextScope class Make context the one of current thread,
+     * as seen by com.aldebaran.qi.QiContext, until destruction.
+     */
+    class CallContextScope
+    {
+      public:
+        CallContextScope(boost::shared_ptr<CallContext> context);
+        ~CallContextScope();
+
+      private:
+        boost::shared_ptr<CallContext> _context;
+        CallContext*                   _previous;
+    };
+  } // !jni
+} // !qi
+
+extern "C"
+{
+  JNIEXPORT jboolean Java_com_aldebaran_qi_QiContext_cancelRequested(JNIEnv* env, jclass cls);
+} // !extern "C"
+
+#endif // !_JAVA_JNI_QICONTEXT_HPP_
@@ -22,6 +22,8 @@ extern "C"
   JNIEXPORT jobject   Java_com_aldebaran_qi_Session_service(JNIEnv* env, jobject obj, jlong pSession, jstring jname);
   JNIEXPORT jint      Java_com_aldebaran_qi_Session_registerService(JNIEnv *env, jobject obj, jlong pSession, jstring name, jobject object);
   JNIEXPORT void      Java_com_aldebaran_qi_Session_unregisterService(JNIEnv *env, jobject obj, jlong pSession, jint serviceId);
+  JNIEXPORT void      Java_com_aldebaran_qi_Session_setCallLimits(JNIEnv *env, jobject obj, jlong pSession, jint maxInFlight, jlong maxBytes, jint overflow);
+  JNIEXPORT jlongArray Java_com_aldebaran_qi_Session_callCounters(JNIEnv *env, jobject obj, jlong pSession);
   JNIEXPORT void      Java_com_aldebaran_qi_Session_onDisconnected(JNIEnv *env, jobject obj, jlong pSession, jstring callbackName, jobject objectInstance);
 
 } // !extern "C"
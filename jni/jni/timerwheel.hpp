@@ -0,0 +1,67 @@
+/*
+**
+** Copyright (C) 2015 Aldebaran Robotics
+** See COPYING for the license
+*/
+
+#ifndef _JAVA_JNI_TIMERWHEEL_HPP_
+#define _JAVA_JNI_TIMERWHEEL_HPP_
+
+#include <list>
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
+#include <boost/unordered_map.hpp>
+#include <qi/clock.hpp>
+#include <qi/types.hpp>
+
+namespace qi
+{
+  /**
+   * @brief The TimerWheel class Hashed timing wheel running callbacks after a delay.
+   * Timers are stored in the slot of their expiry tick: scheduling and
+   * canceling cost O(1), whatever the number of pending timers.
+   * Callbacks run in the wheel thread, they must be short.
+   */
+  class TimerWheel
+  {
+    public:
+      TimerWheel(qi::MilliSeconds tick, unsigned int slotCount);
+      ~TimerWheel();
+
+      /// Run callback after delay, rounded up to the next tick. Return an id for cancel.
+      qi::uint64_t schedule(qi::MilliSeconds delay, const boost::function<void ()>& callback);
+      /// Forget timer if it did not expire yet.
+      void cancel(qi::uint64_t id);
+
+    private:
+      struct Timer
+      {
+        qi::uint64_t             id;
+        unsigned int             rounds; // Full turns of the wheel before expiry
+        boost::function<void ()> callback;
+      };
+      typedef std::list<Timer> Slot;
+
+      void run();
+
+      boost::mutex                                              _mutex;
+      boost::condition_variable                                 _cond;
+      std::vector<Slot>                                         _slots;
+      boost::unordered_map<qi::uint64_t, std::pair<unsigned int, Slot::iterator> > _timers;
+      qi::MilliSeconds                                          _tick;
+      unsigned int                                              _cursor; // Slot of current tick
+      qi::SteadyClock::time_point                               _next; // Time of next tick
+      qi::uint64_t                                              _nextId;
+      bool                                                      _stopping;
+      boost::thread*                                            _thread;
+  };
+
+} // !qi
+
+/**
+ * Wheel enforcing call deadlines. Created on first use.
+ */
+qi::TimerWheel* java_timer_wheel();
+
+#endif // !_JAVA_JNI_TIMERWHEEL_HPP_
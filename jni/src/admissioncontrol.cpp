@@ -0,0 +1,114 @@
+/*
+**
+** Copyright (C) 2015 Aldebaran Robotics
+** See COPYING for the license
+*/
+
+#include <qi/log.hpp>
+
+#include <admissioncontrol.hpp>
+
+qiLogCategory("qimessaging.jni");
+
+namespace qi {
+
+  AdmissionControl::AdmissionControl()
+    : _running(0)
+    , _maxConcurrent(0)
+    , _maxQueued(0)
+    , _maxQueueDelay(0)
+  {
+  }
+
+  void AdmissionControl::setLimits(unsigned int maxConcurrent, unsigned int maxQueued, qi::MilliSeconds maxQueueDelay)
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    _maxConcurrent = maxConcurrent;
+    _maxQueued = maxQueued;
+    _maxQueueDelay = maxQueueDelay;
+  }
+
+  bool AdmissionControl::expired(const Pending& pending, const qi::SteadyClock::time_point& now) const
+  {
+    return _maxQueueDelay.count() > 0 && now - pending.queued > _maxQueueDelay;
+  }
+
+  void AdmissionControl::submit(const Start& start, const Reject& reject)
+  {
+    Rejections rejections;
+    bool run = false;
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+      qi::SteadyClock::time_point now = qi::SteadyClock::now();
+
+      // Calls that already waited too long will be shed anyway, make room now.
+      while (!_pending.empty() && expired(_pending.front(), now))
+      {
+        rejections.push_back(std::make_pair(_pending.front().reject, std::string("Service overloaded: call waited too long in queue")));
+        _pending.pop_front();
+      }
+
+      if (!_maxConcurrent || _running < _maxConcurrent)
+      {
+        ++_running;
+        run = true;
+      }
+      else if (_maxQueued && _pending.size() >= _maxQueued)
+        rejections.push_back(std::make_pair(reject, std::string("Service overloaded: call queue is full")));
+      else
+      {
+        Pending pending;
+        pending.start = start;
+        pending.reject = reject;
+        pending.queued = now;
+        _pending.push_back(pending);
+      }
+    }
+
+    for (Rejections::iterator it = rejections.begin(); it != rejections.end(); ++it)
+      it->first(it->second);
+    if (run)
+      startCall(start, reject);
+  }
+
+  void AdmissionControl::startCall(Start start, Reject reject)
+  {
+    if (start())
+      return;
+    reject("Service executor queue is full");
+    finish();
+  }
+
+  void AdmissionControl::finish()
+  {
+    Rejections rejections;
+    Pending next;
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+      qi::SteadyClock::time_point now = qi::SteadyClock::now();
+
+      while (!_pending.empty() && expired(_pending.front(), now))
+      {
+        rejections.push_back(std::make_pair(_pending.front().reject, std::string("Service overloaded: call waited too long in queue")));
+        _pending.pop_front();
+      }
+
+      // Room of the finished call goes to the next one.
+      if (_pending.empty() || (_maxConcurrent && _running > _maxConcurrent))
+        --_running;
+      else
+      {
+        next = _pending.front();
+        _pending.pop_front();
+      }
+    }
+
+    if (!rejections.empty())
+      qiLogVerbose() << "Shedding " << rejections.size() << " calls";
+    for (Rejections::iterator it = rejections.begin(); it != rejections.end(); ++it)
+      it->first(it->second);
+    if (next.start)
+      startCall(next.start, next.reject);
+  }
+
+} // !qi
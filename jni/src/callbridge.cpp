@@ -16,19 +16,189 @@
 
 #include <callbridge.hpp>
 #include <jobjectconverter.hpp>
+#include <future_jni.hpp>
 #include <jnitools.hpp>
+#include <priority_jni.hpp>
+#include <qicontext_jni.hpp>
+#include <timerwheel.hpp>
 
 qiLogCategory("qimessaging.jni");
 
 MethodInfoHandler gInfoHandler;
 
+static void call_from_java_cont_async(qi::Future<qi::AnyValue> ret,
+    qi::Promise<qi::AnyValue> promise)
+{
+  // Promise of a call with a deadline is already failed if it expired.
+  if (!promise.future().isRunning())
+    return;
+
+  try
+  {
+    if (ret.isCanceled())
+      promise.setCanceled();
+    else if (ret.hasError())
+      promise.setError(ret.error());
+    else
+      promise.setValue(ret.value());
+  }
+  catch (std::exception&)
+  {
+    // Deadline expired concurrently.
+  }
+}
+
+/**
+ * @brief set_error_once Fail promise unless it is already finished.
+ * @return false if promise was already finished
+ */
+static bool set_error_once(qi::Promise<qi::AnyValue> promise, const std::string& error)
+{
+  if (!promise.future().isRunning())
+    return false;
+
+  try
+  {
+    promise.setError(error);
+  }
+  catch (std::exception&)
+  {
+    // Finished concurrently.
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief cancel_call Request cancel of a call through its canceler.
+ * Cancelers only hold a weak reference on the call: a promise forwarding
+ * cancel to the call it is completed by does not keep it alive.
+ */
+static void cancel_call(const boost::function<void ()>& canceler)
+{
+  try
+  {
+    canceler();
+  }
+  catch (std::exception&)
+  {
+    // Not cancelable
+  }
+}
+
+static void expire_call_from_java(qi::Promise<qi::AnyValue> promise, boost::function<void ()> canceler)
+{
+  if (!set_error_once(promise, "Call timed out"))
+    return;
+
+  // Free the call, its result is not expected anymore.
+  cancel_call(canceler);
+}
+
+static void cancel_call_from_java(boost::function<void ()> canceler, qi::Promise<qi::AnyValue>& QI_UNUSED(promise))
+{
+  cancel_call(canceler);
+}
+
+static void cancel_deadline(qi::uint64_t timer)
+{
+  java_timer_wheel()->cancel(timer);
+}
+
+qi::Future<qi::AnyValue> call_with_deadline(qi::Future<qi::AnyValue> call, qi::MilliSeconds timeout)
+{
+  qi::Promise<qi::AnyValue> promise(boost::bind(&cancel_call_from_java, call.makeCanceler(), _1));
+
+  qi::uint64_t timer = java_timer_wheel()->schedule(timeout, boost::bind(&expire_call_from_java, promise, call.makeCanceler()));
+  // Whatever finishes first, the timer is not needed anymore.
+  promise.future().connect(boost::bind(&cancel_deadline, timer));
+  call.connect(call_from_java_cont_async, _1, promise);
+  return promise.future();
+}
+
+/**
+ * @brief set_promise_from_result Complete a promise with the result of a call.
+ * @param value call result, ownership is taken
+ * @param promise promise to complete
+ *
+ * Methods implemented asynchronously (a Java service returning a Future, or a
+ * call dispatched on an executor) return a future: the promise is then
+ * completed when it finishes.
+ */
+static void set_promise_from_result(qi::AnyReference value, qi::Promise<qi::AnyValue> promise)
+{
+  if (value.type() && value.type()->info() == qi::typeOf<qi::Future<qi::AnyValue> >()->info())
+  {
+    qi::Future<qi::AnyValue> async = *value.ptr<qi::Future<qi::AnyValue> >(false);
+    value.destroy();
+    async.connect(call_from_java_cont_async, _1, promise);
+    return;
+  }
+
+  promise.setValue(qi::AnyValue(value, false, true));
+}
+
 static void call_from_java_cont(qi::Future<qi::AnyReference> ret,
     qi::Promise<qi::AnyValue> promise)
 {
-  if (ret.hasError())
+  if (ret.isCanceled())
+    promise.setCanceled();
+  else if (ret.hasError())
     promise.setError(ret.error());
   else
-    promise.setValue(qi::AnyValue(ret.value(), false, true));
+    set_promise_from_result(ret.value(), promise);
+}
+
+/**
+ * @brief cancel_meta_call Forward cancel request of a Java call to the qiMessaging call.
+ * A remote object sends it to the service, whose Java method sees it through QiContext.
+ */
+static void cancel_meta_call(boost::function<void ()> canceler, qi::Promise<qi::AnyValue>& QI_UNUSED(promise))
+{
+  cancel_call(canceler);
+}
+
+/**
+ * @brief call_qi_method Call qiMessaging method, without JNI environment.
+ * @param object The object to call
+ * @param strMethodName Name (with or without signature) of the method to call
+ * @param params Parameters of the call, Java objects or native values
+ * @return Future of the call result, throws std::runtime_error if call cannot be made
+ */
+qi::Future<qi::AnyValue> call_qi_method(qi::AnyObject object, const std::string& strMethodName, const qi::GenericFunctionParameters& params)
+{
+  // Create future and start metacall
+  // philippe: must be sync or testCallback is broken (future from metacall is
+  // sync, don't know why)
+  qi::Future<qi::AnyReference> metfut =
+    object.metaCall(strMethodName, params);
+  // The continuation of metfut holds the promise: the promise only holds a weak reference on metfut.
+  qi::Promise<qi::AnyValue> promise(boost::bind(&cancel_meta_call, metfut.makeCanceler(), _1), qi::FutureCallbackType_Sync);
+  metfut.connect(call_from_java_cont, _1, promise);
+  return promise.future();
+}
+
+/**
+ * @brief call_from_java Helper function to call qiMessaging method
+ * @param env JNI environment given by JVM.
+ * @param object The proxy making the call
+ * @param strMethodName Name (with or without signature) of the method to call
+ * @param params Parameters of the call, Java objects or native values
+ * @return
+ */
+qi::Future<qi::AnyValue> call_from_java(JNIEnv *env, qi::AnyObject object, const std::string& strMethodName, const qi::GenericFunctionParameters& params)
+{
+  try
+  {
+    return call_qi_method(object, strMethodName, params);
+  } catch (std::runtime_error &e)
+  {
+    qi::jni::throwCallError(env, e.what(), qi::jni::callErrorKind(e.what()));
+
+    qi::Promise<qi::AnyValue> promise;
+    promise.setError(e.what());
+    return promise.future();
+  }
 }
 
 /**
@@ -39,15 +209,29 @@ static void call_from_java_cont(qi::Future<qi::AnyReference> ret,
  * @param listParams List of Java parameters given for call
  * @return
  */
-qi::Future<qi::AnyValue>* call_from_java(JNIEnv *env, qi::AnyObject object, const std::string& strMethodName, jobjectArray listParams)
+qi::Future<qi::AnyValue> call_from_java(JNIEnv *env, qi::AnyObject object, const std::string& strMethodName, jobjectArray listParams)
 {
   qi::GenericFunctionParameters params;
+  std::vector<jobject> objs;
+
+  java_call_parameters(env, listParams, objs, params);
+  return call_from_java(env, object, strMethodName, params);
+}
+
+/**
+ * @brief java_call_parameters Reference Java parameters of a call as call parameters.
+ * @param env JNI environment given by JVM.
+ * @param listParams List of Java parameters given for call
+ * @param objs Local references on parameters, must outlive params
+ * @param params Call parameters
+ */
+void java_call_parameters(JNIEnv* env, jobjectArray listParams, std::vector<jobject>& objs, qi::GenericFunctionParameters& params)
+{
   jsize size;
   jsize i = 0;
 
   size = env->GetArrayLength(listParams);
   // We need to take references on jobjects, so they can't move while we make the call
-  std::vector<jobject> objs;
   objs.resize(size);
   while (i < size)
   {
@@ -56,142 +240,827 @@ qi::Future<qi::AnyValue>* call_from_java(JNIEnv *env, qi::AnyObject object, cons
     params.push_back(qi::AnyReference::from(objs[i]));
     ++i;
   }
-  // Create future and start metacall
-  // philippe: must be sync or testCallback is broken (future from metacall is
-  // sync, don't know why)
-  qi::Promise<qi::AnyValue> promise(qi::FutureCallbackType_Sync);
-  qi::Future<qi::AnyValue> *fut = new qi::Future<qi::AnyValue>();
-  try
+}
+
+/**
+ * @brief jobject_passthrough_signature Check if an argument can be given to Java as is.
+ * @param env JNI environment
+ * @param arg argument received by call_to_java
+ * @param expected qitype signature of the matching Java method parameter
+ * @return signature the argument is checked against if it can be passed through, an empty string otherwise
+ *
+ * Arguments coming from a Java caller in the same process are jobject typed references.
+ * Converting them to an AnyValue and back to a jobject is useless when the Java object
+ * already has the type expected by the method.
+ */
+static std::string jobject_passthrough_signature(JNIEnv* env, const qi::AnyReference& arg, const std::string& expected)
+{
+  if (expected.empty() || arg.type() != qi::typeOf<jobject>())
+    return std::string();
+
+  jobject value = *(jobject*)arg.rawValue();
+  if (!value)
+    return std::string();
+
+  std::string signature = qi::jni::qiSignature(env, value);
+  if (signature.empty())
+    return signature;
+  if (expected == signature || expected[0] == qi::Signature::Type_Dynamic)
+    return expected;
+  return std::string();
+}
+
+/**
+ * @brief java_caller Check if a call comes from a Java caller living in this JVM.
+ * Its arguments are then jobject typed references, see java_call_parameters.
+ */
+static bool java_caller(const qi::GenericFunctionParameters& params)
+{
+  for (qi::GenericFunctionParameters::const_iterator it = params.begin(); it != params.end(); ++it)
   {
-    qi::Future<qi::AnyReference> metfut =
-      object.metaCall(strMethodName, params);
-    metfut.connect(call_from_java_cont, _1, promise);
-    *fut = promise.future();
-  } catch (std::runtime_error &e)
+    if (it->type() == qi::typeOf<jobject>())
+      return true;
+  }
+  return false;
+}
+
+/**
+ * @brief java_result Native result of a Java method, ownership is given.
+ * @param javaCaller true if the call comes from a Java caller living in this JVM
+ *
+ * A Java caller in this JVM gets the Java object back untouched. Other callers get
+ * it converted now, in the JNI thread of the call, instead of lazily by the
+ * serialization of the result on an event loop thread.
+ */
+static qi::AnyReference java_result(jobject ret, bool javaCaller)
+{
+  if (ret && javaCaller)
+    return qi::AnyReference::from(ret).clone();
+  return AnyValue_from_JObject(ret).first;
+}
+
+/**
+ * @brief find_java_method Look for an instance method, then for a static one.
+ * @param env JNI environment
+ * @param cls class implementing the method
+ * @param name method name
+ * @param javaSignature Java signature of the method
+ * @return method ID, 0 if not found
+ */
+static jmethodID find_java_method(JNIEnv* env, jclass cls, const std::string& name, const std::string& javaSignature)
+{
+  jmethodID mid = env->GetMethodID(cls, name.c_str(), javaSignature.c_str());
+  if (env->ExceptionCheck()) // NoSuchMethodError
+    env->ExceptionClear();
+  if (!mid)
+    mid = env->GetStaticMethodID(cls, name.c_str(), javaSignature.c_str());
+  if (env->ExceptionCheck()) // NoSuchMethodError
+    env->ExceptionClear();
+  return mid;
+}
+
+/**
+ * @brief unboxed_java_type Java primitive type matching a qitype signature element.
+ * @return Java type code, 0 if element has no primitive counterpart
+ */
+static char unboxed_java_type(const std::string& element)
+{
+  if (element.size() != 1)
+    return 0;
+
+  switch (element[0])
   {
-    delete fut;
-    throwJavaError(env, e.what());
+  case qi::Signature::Type_Bool:
+    return 'Z';
+  case qi::Signature::Type_Int32:
+    return 'I';
+  case qi::Signature::Type_Int64:
+    return 'J';
+  case qi::Signature::Type_Float:
+    return 'F';
+  case qi::Signature::Type_Double:
+    return 'D';
+  case qi::Signature::Type_Void:
+    return 'V';
+  default:
     return 0;
   }
-  return fut;
 }
 
 /**
- * @brief call_to_java Heller function to call Java methods.
+ * @brief toUnboxedJavaSignature Java signature with primitive types, as (IF)V for v(if).
+ * @param signature qitype signature
+ * @return Java signature, empty if an element of signature has no primitive counterpart
+ */
+static std::string toUnboxedJavaSignature(const std::string& signature)
+{
+  std::vector<std::string> sigInfo = qi::signatureSplit(signature);
+  const std::vector<qi::Signature>& params = qi::Signature(sigInfo[2]).children();
+  std::string sig = "(";
+
+  for (std::vector<qi::Signature>::const_iterator it = params.begin(); it != params.end(); ++it)
+  {
+    char type = unboxed_java_type(it->toString());
+    if (!type || type == 'V')
+      return std::string();
+    sig += type;
+  }
+  sig += ")";
+
+  char ret = unboxed_java_type(sigInfo[0].empty() ? "v" : sigInfo[0]);
+  if (!ret)
+    return std::string();
+  sig += ret;
+  return sig;
+}
+
+bool prepare_java_method(JNIEnv* env, qi_method_info* info)
+{
+  std::vector<std::string> sigInfo = qi::signatureSplit(info->sig);
+  jclass cls = qi::jni::clazz(info->instance);
+
+  if (!cls)
+  {
+    qiLogError() << "Service class not found";
+    return false;
+  }
+
+  // Primitive parameters first: no boxing on each call.
+  std::string javaSignature = toUnboxedJavaSignature(info->sig);
+  jmethodID mid = 0;
+  JavaMethodKind kind = JavaMethod_Unboxed;
+  if (!javaSignature.empty())
+    mid = find_java_method(env, cls, sigInfo[1], javaSignature);
+
+  if (!mid)
+  {
+    javaSignature = toJavaSignature(info->sig);
+    kind = JavaMethod_Boxed;
+    mid = find_java_method(env, cls, sigInfo[1], javaSignature);
+  }
+
+  if (!mid)
+  {
+    // Asynchronous implementation: same parameters, returns a com.aldebaran.qi.Future.
+    javaSignature = javaSignature.substr(0, javaSignature.find(')') + 1) + "L" QI_FUTURE_CLASS ";";
+    kind = JavaMethod_Future;
+    mid = find_java_method(env, cls, sigInfo[1], javaSignature);
+  }
+  qi::jni::releaseClazz(cls);
+
+  if (!mid)
+    return false;
+
+  qiLogVerbose() << "Bound " << info->sig << " to " << sigInfo[1] << javaSignature;
+  info->kind = kind;
+  info->mid = mid;
+  return true;
+}
+
+/**
+ * @brief unboxed_value Primitive Java value of a parameter.
+ * @param arg parameter
+ * @param type Java type code of the parameter
+ */
+static jvalue unboxed_value(const qi::AnyReference& arg, char type)
+{
+  jvalue value;
+
+  switch (type)
+  {
+  case 'Z':
+    value.z = arg.toInt() != 0;
+    break;
+  case 'I':
+    value.i = static_cast<jint>(arg.toInt());
+    break;
+  case 'J':
+    value.j = static_cast<jlong>(arg.toInt());
+    break;
+  case 'F':
+    value.f = arg.toFloat();
+    break;
+  default:
+    value.d = arg.toDouble();
+    break;
+  }
+  return value;
+}
+
+/**
+ * @brief call_unboxed_method Call a Java method taking and returning primitive types.
+ * @return result as a native value
+ */
+static qi::AnyReference call_unboxed_method(JNIEnv* env, qi_method_info* info, char ret, jvalue* args)
+{
+  switch (ret)
+  {
+  case 'Z':
+    return qi::AnyReference::from(env->CallBooleanMethodA(info->instance, info->mid, args) != JNI_FALSE).clone();
+  case 'I':
+    return qi::AnyReference::from(static_cast<int>(env->CallIntMethodA(info->instance, info->mid, args))).clone();
+  case 'J':
+    return qi::AnyReference::from(static_cast<qi::int64_t>(env->CallLongMethodA(info->instance, info->mid, args))).clone();
+  case 'F':
+    return qi::AnyReference::from(static_cast<float>(env->CallFloatMethodA(info->instance, info->mid, args))).clone();
+  case 'D':
+    return qi::AnyReference::from(static_cast<double>(env->CallDoubleMethodA(info->instance, info->mid, args))).clone();
+  default:
+    env->CallVoidMethodA(info->instance, info->mid, args);
+    return qi::AnyReference(qi::typeOf<void>());
+  }
+}
+
+/**
+ * @brief call_java_method Call Java implementation in current thread.
  * @param signature qitype signature formated
- * @param data pointer on a qi_method_info (which hold Java object class and reference)
+ * @param info Java object class and reference
  * @param params parameters to forward to called method
- * @return
+ * @return result of the method, a qi::Future<qi::AnyValue> if implementation is asynchronous
  */
-qi::AnyReference call_to_java(std::string signature, void* data, const qi::GenericFunctionParameters& params)
+static qi::AnyReference call_java_method(const std::string& signature, qi_method_info* info, const qi::GenericFunctionParameters& params)
 {
+  static boost::mutex prepareMutex;
   qi::AnyReference res;
   jvalue*             args = new jvalue[params.size()];
   int                 index = 0;
   JNIEnv*             env = 0;
-  qi_method_info*     info = reinterpret_cast<qi_method_info*>(data);
-  jclass              cls = 0;
   std::vector<std::string>  sigInfo = qi::signatureSplit(signature);
 
   qi::jni::JNIAttach attach;
   env = attach.get();
 
-  // Check value of method info structure
-  if (info == 0)
+  // Method is normally resolved when advertised or connected: the lock is only
+  // taken if it is not.
+  if (!info->mid)
   {
-    qiLogError() << "Internal method informations are not valid";
-    throwJavaError(env, "Internal method informations are not valid");
-    return res;
+    boost::mutex::scoped_lock lock(prepareMutex);
+    if (!info->mid && !prepare_java_method(env, info))
+    {
+      delete[] args;
+      qiLogError() << "Cannot find java method " << sigInfo[1] << toJavaSignature(signature);
+      throw std::runtime_error("Cannot find method");
+    }
   }
+  bool unboxed = (info->kind == JavaMethod_Unboxed);
+
   // Translate parameters from AnyValues to jobjects
+  qi::Signature to = qi::Signature(sigInfo[2]);
+  const std::vector<qi::Signature>& expected = to.children();
   qi::GenericFunctionParameters::const_iterator it = params.begin();
   qi::GenericFunctionParameters::const_iterator end = params.end();
-  std::vector<qi::TypeInterface*> types;
+  std::string fromSignature = "(";
   for(; it != end; it++)
   {
     jvalue value;
+
+    // Primitive parameters are converted once signature is checked.
+    if (unboxed)
+    {
+      if (it->kind() == qi::TypeKind_Dynamic)
+        fromSignature += (**it).type()->signature().toString();
+      else
+        fromSignature += it->type()->signature().toString();
+      continue;
+    }
+
+    // Argument given by a Java caller living in this JVM: if it already has
+    // the expected Java type, pass it through instead of doing a round trip
+    // through AnyValue.
+    std::string passthrough = jobject_passthrough_signature(env, *it,
+        index < (int) expected.size() ? expected[index].toString() : std::string());
+    if (!passthrough.empty())
+    {
+      value.l = env->NewLocalRef(*(jobject*)it->rawValue());
+      fromSignature += passthrough;
+      args[index] = value;
+      index++;
+      continue;
+    }
+
     value.l = JObject_from_AnyValue(*it);
     qiLogVerbose() << "Converted argument " << (it-params.begin()) << it->type()->infoString();
     if (it->kind() == qi::TypeKind_Dynamic)
     {
       qiLogVerbose() << "Argument is " << (**it).type()->infoString();
-      types.push_back((**it).type());
+      fromSignature += (**it).type()->signature().toString();
     }
     else
-      types.push_back(it->type());
+      fromSignature += it->type()->signature().toString();
     args[index] = value;
     index++;
   }
+  fromSignature += ")";
 
   // Check if function is callable
-  qi::Signature from = qi::makeTupleSignature(types);
-  qi::Signature to = qi::Signature(sigInfo[2]);
+  qi::Signature from = qi::Signature(fromSignature);
   if (from.isConvertibleTo(to) == 0)
   {
     std::ostringstream ss;
     ss << "cannot convert parameters from " << from.toString() << " to " << to.toString();
     qiLogVerbose() << ss.str();
+    while (--index >= 0)
+      qi::jni::releaseObject(args[index].l);
+    delete[] args;
     throw std::runtime_error(ss.str());
   }
 
-  // Find method class and get methodID
-  cls = qi::jni::clazz(info->instance);
-  if (!cls)
+  if (unboxed)
   {
-    qiLogError() << "Service class not found";
-    throw std::runtime_error("Service class not found");
+    for (unsigned int i = 0; i < params.size(); ++i)
+      args[i] = unboxed_value(params[i], unboxed_java_type(expected[i].toString()));
   }
 
-  // Find method ID
-  std::string javaSignature = toJavaSignature(signature);
-  qiLogVerbose() << "looking for method " << signature << " -> " << javaSignature;
-  jmethodID mid = env->GetMethodID(cls, sigInfo[1].c_str(), javaSignature.c_str());
-  if (env->ExceptionCheck()) // NoSuchMethodError
-    env->ExceptionClear();
-  if (!mid)
-    mid = env->GetStaticMethodID(cls, sigInfo[1].c_str(), javaSignature.c_str());
-  if (env->ExceptionCheck()) // NoSuchMethodError
-    env->ExceptionClear();
-  if (!mid)
+  // Call method
+  qiLogVerbose() << "Entering call";
+  if (unboxed)
   {
-    qiLogError() << "Cannot find java method " << sigInfo[1] << javaSignature.c_str();
-    throw std::runtime_error("Cannot find method");
+    res = call_unboxed_method(env, info, unboxed_java_type(sigInfo[0].empty() ? "v" : sigInfo[0]), args);
   }
+  else if (info->kind == JavaMethod_Future)
+  {
+    jobject ret = env->CallObjectMethodA(info->instance, info->mid, args);
+    if (!env->ExceptionCheck())
+    {
+      qi::Future<qi::AnyValue> fut;
+      bool valid = java_future(env, ret, fut);
+      qi::jni::releaseObject(ret);
+      if (!valid)
+        throw std::runtime_error("Asynchronous method returned an invalid Future");
 
-  // Call method
-  qiLogVerbose() << "Entering call";
-  if (sigInfo[0] == "" || sigInfo[0] == "v")
+      // The call completes when the returned future does, event-loop thread is freed now.
+      res = qi::AnyReference::from(fut).clone();
+    }
+  }
+  else if (sigInfo[0] == "" || sigInfo[0] == "v")
   {
-    env->CallVoidMethodA(info->instance, mid, args);
+    env->CallVoidMethodA(info->instance, info->mid, args);
     res = qi::AnyReference(qi::typeOf<void>());
   }
   else
   {
-    jobject ret = env->CallObjectMethodA(info->instance, mid, args);
+    jobject ret = env->CallObjectMethodA(info->instance, info->mid, args);
     if (!env->ExceptionCheck())
     {
-      res = AnyValue_from_JObject(ret).first;
+      res = java_result(ret, java_caller(params));
       qi::jni::releaseObject(ret);
     }
   }
   qiLogVerbose() << "Finished call";
 
+  // Release arguments
+  while (--index >= 0)
+    qi::jni::releaseObject(args[index].l);
+  delete[] args;
+
   // Did method thrown ?
   if (env->ExceptionCheck())
+    throw std::runtime_error(qi::jni::javaExceptionMessage(env));
+
+  return res;
+}
+
+/**
+ * @brief call_java_method_task Run a call dispatched on a service executor or the event loop.
+ * @param context cancellation state of a cancellable method, empty otherwise
+ */
+static void call_java_method_task(const std::string& signature, qi_method_info* info,
+    qi::GenericFunctionParameters params, qi::Promise<qi::AnyValue> promise,
+    boost::shared_ptr<qi::jni::CallContext> context)
+{
+  try
   {
-    env->ExceptionDescribe();
-    env->ExceptionClear();
-    throw std::runtime_error("Remote method thrown exception");
+    if (!promise.future().isRunning() || (context && *context->cancelRequested))
+    {
+      // Canceled or past its deadline while waiting for a thread
+      if (promise.future().isRunning())
+        promise.setCanceled();
+      params.destroy();
+      return;
+    }
+
+    qi::jni::CallContextScope scope(context);
+    qi::AnyReference res = call_java_method(signature, info, params);
+
+    if (!promise.future().isRunning())
+      res.destroy(); // Deadline expired while running
+    else if (context && *context->cancelRequested)
+    {
+      res.destroy();
+      promise.setCanceled();
+    }
+    else
+      set_promise_from_result(res, promise);
+  }
+  catch (std::exception& e)
+  {
+    set_error_once(promise, e.what());
   }
+  params.destroy();
+}
+
+static void request_cancel(boost::shared_ptr<qi::jni::CallContext> context, qi::Promise<qi::AnyValue>& QI_UNUSED(promise))
+{
+  ++context->cancelRequested;
+}
+
+/**
+ * @brief expire_call_to_java Fail a call past its deadline, and let its Java implementation know it can stop.
+ */
+static void expire_call_to_java(boost::shared_ptr<qi::jni::CallContext> context, qi::Promise<qi::AnyValue> promise)
+{
+  ++context->cancelRequested;
+  set_error_once(promise, "Call deadline exceeded");
+}
+
+static void memoize_result(boost::shared_ptr<qi::MemoCache> memo, const std::string& key, qi::Future<qi::AnyValue> result)
+{
+  if (result.hasError() || result.isCanceled())
+    return;
+  memo->put(key, AnyValue_native_copy(result.value().asReference()));
+}
+
+/**
+ * @brief post_java_task Queue a call on service executor, or on the event loop if there is none.
+ * @return false if executor queue is full
+ */
+static bool post_java_task(qi_method_info* info, const boost::function<void ()>& task)
+{
+  // setExecutor may replace the executor meanwhile.
+  boost::shared_ptr<qi::JavaExecutor> executor;
+  if (info->service)
+    executor = boost::atomic_load(&info->service->executor);
+  if (!executor)
+  {
+    qi::getEventLoop()->post(task);
+    return true;
+  }
+  return executor->post(task);
+}
+
+/**
+ * @brief java_concurrency Concurrency of a call with the other calls of its object, as JavaConcurrency.
+ */
+static int java_concurrency(qi_method_info* info, const qi::GenericFunctionParameters& params)
+{
+  if (!info->service)
+    return JavaConcurrency_Concurrent;
+  if (info->concurrency == JavaConcurrency_Default)
+    return info->service->threadSafe ? JavaConcurrency_Concurrent : JavaConcurrency_Exclusive;
+  if (info->concurrency == JavaConcurrency_Strand && info->strandKey >= params.size())
+    return JavaConcurrency_Concurrent;
+  return info->concurrency;
+}
+
+/**
+ * @brief queue_java_task Queue a call on its thread once the calls of its object it must not overlap are done.
+ * Waiting calls hold no thread, the service call gate queues them when their turn comes.
+ * @param key strand key of the call
+ * @param drop fails the call if it cannot be queued when its turn comes
+ * @return false if the call could not be queued right away
+ */
+static bool queue_java_task(qi_method_info* info, int concurrency, const qi::AnyValue& key,
+                            const boost::function<void ()>& task, const boost::function<void ()>& drop)
+{
+  if (concurrency == JavaConcurrency_Concurrent)
+    return post_java_task(info, task);
+
+  info->service->gate->submit(concurrency == JavaConcurrency_Exclusive,
+                              concurrency == JavaConcurrency_Strand ? &key : 0,
+                              task, boost::bind(&post_java_task, info, _1), drop);
+  return true;
+}
 
-  // Release instance clazz
+/**
+ * @brief admitted_java_task Run a call admitted by service admission control, then give its room to the next one.
+ */
+static void admitted_java_task(boost::shared_ptr<qi::AdmissionControl> admission, boost::function<void ()> task,
+                               qi::Future<qi::AnyValue> result)
+{
+  task();
+  // A method returning a Future keeps its room until that future completes.
+  result.connect(boost::bind(&qi::AdmissionControl::finish, admission));
+}
+
+/**
+ * @brief reject_java_call Fail a queued call that will never run.
+ */
+static void reject_java_call(qi::Promise<qi::AnyValue> promise, qi::GenericFunctionParameters params, const std::string& reason)
+{
+  params.destroy();
+  promise.setError(reason);
+}
+
+/**
+ * @brief drop_java_call Fail a call the service call gate could not queue, and release its admission room.
+ */
+static void drop_java_call(boost::shared_ptr<qi::AdmissionControl> admission, qi::Promise<qi::AnyValue> promise,
+                           qi::GenericFunctionParameters params)
+{
+  reject_java_call(promise, params, "Service executor queue is full");
+  if (admission)
+    admission->finish();
+}
+
+bool prepare_java_batch(JNIEnv* env, qi_method_info* info, const std::string& handler, unsigned int maxBatchSize)
+{
+  jclass cls = qi::jni::clazz(info->instance);
+
+  if (!cls)
+    return false;
+
+  boost::shared_ptr<qi_batch_info> batch(new qi_batch_info());
+  batch->returnsResults = true;
+  batch->handler = find_java_method(env, cls, handler, "([[Ljava/lang/Object;)[Ljava/lang/Object;");
+  if (!batch->handler)
+  {
+    batch->returnsResults = false;
+    batch->handler = find_java_method(env, cls, handler, "([[Ljava/lang/Object;)V");
+  }
   qi::jni::releaseClazz(cls);
 
-  // Release arguments
-  while (--index >= 0)
-    qi::jni::releaseObject(args[index].l);
-  delete[] args;
+  if (!batch->handler)
+  {
+    qiLogError() << "Cannot find batch handler " << handler << " of " << info->sig;
+    return false;
+  }
+  batch->maxBatchSize = maxBatchSize;
+  info->batch = batch;
+  return true;
+}
+
+/**
+ * @brief java_argument Java object of a call or event argument, as a local reference.
+ */
+static jobject java_argument(JNIEnv* env, const qi::AnyReference& arg)
+{
+  // Argument of a Java caller living in this JVM is given as is.
+  if (arg.type() == qi::typeOf<jobject>())
+    return env->NewLocalRef(*(jobject*)arg.rawValue());
+  return JObject_from_AnyValue(arg);
+}
+
+/**
+ * @brief call_java_batch Give calls to Java batch handler in a single JNI call, complete them from its result.
+ */
+static void call_java_batch(JNIEnv* env, qi_method_info* info, std::vector<qi_batch_info::Call>& calls)
+{
+  qi_batch_info& batch = *info->batch;
+  jclass objectClass = env->FindClass("java/lang/Object");
+  jclass arrayClass = env->FindClass("[Ljava/lang/Object;");
+  jobjectArray jcalls = env->NewObjectArray(calls.size(), arrayClass, 0);
+
+  for (size_t i = 0; i < calls.size(); ++i)
+  {
+    const qi::GenericFunctionParameters& params = calls[i].first;
+    jobjectArray jargs = env->NewObjectArray(params.size(), objectClass, 0);
+
+    for (size_t j = 0; j < params.size(); ++j)
+    {
+      jobject arg = java_argument(env, params[j]);
+      env->SetObjectArrayElement(jargs, j, arg);
+      qi::jni::releaseObject(arg);
+    }
+    env->SetObjectArrayElement(jcalls, i, jargs);
+    env->DeleteLocalRef(jargs);
+  }
+  env->DeleteLocalRef(arrayClass);
+  env->DeleteLocalRef(objectClass);
+
+  jobjectArray results = 0;
+  if (batch.returnsResults)
+    results = (jobjectArray) env->CallObjectMethod(info->instance, batch.handler, jcalls);
+  else
+    env->CallVoidMethod(info->instance, batch.handler, jcalls);
+  env->DeleteLocalRef(jcalls);
+
+  std::string error;
+  if (env->ExceptionCheck())
+    error = qi::jni::javaExceptionMessage(env);
+  else if (batch.returnsResults && (!results || env->GetArrayLength(results) != (jsize) calls.size()))
+    error = "Batch handler must return one result per call";
+
+  for (size_t i = 0; i < calls.size(); ++i)
+  {
+    qi::Promise<qi::AnyValue>& promise = calls[i].second;
+
+    if (!error.empty())
+    {
+      promise.setError(error);
+      continue;
+    }
+    if (!batch.returnsResults)
+    {
+      promise.setValue(qi::AnyValue(qi::typeOf<void>()));
+      continue;
+    }
+
+    jobject ret = env->GetObjectArrayElement(results, i);
+    qi::AnyReference res = java_result(ret, java_caller(calls[i].first));
+    qi::jni::releaseObject(ret);
+    set_promise_from_result(res, promise);
+  }
+  if (results)
+    qi::jni::releaseObject(results);
+}
+
+/**
+ * @brief drop_java_batch Fail pending calls of a batched method when no delivery task can be queued.
+ */
+static void drop_java_batch(qi_method_info* info)
+{
+  qi_batch_info& batch = *info->batch;
+  std::deque<qi_batch_info::Call> dropped;
+  {
+    boost::mutex::scoped_lock lock(batch.mutex);
+    dropped.swap(batch.pending);
+    batch.scheduled = false;
+  }
+  for (std::deque<qi_batch_info::Call>::iterator it = dropped.begin(); it != dropped.end(); ++it)
+  {
+    it->first.destroy();
+    it->second.setError("Service executor queue is full");
+  }
+}
+
+static void flush_java_batch(qi_method_info* info);
+
+/**
+ * @brief queue_java_batch Queue delivery of pending calls of a batched method.
+ */
+static void queue_java_batch(qi_method_info* info)
+{
+  // Same concurrency as a call of a method without concurrency.
+  int concurrency = info->service->threadSafe ? JavaConcurrency_Concurrent : JavaConcurrency_Exclusive;
+  if (!queue_java_task(info, concurrency, qi::AnyValue(), boost::bind(&flush_java_batch, info), boost::bind(&drop_java_batch, info)))
+    drop_java_batch(info);
+}
+
+/**
+ * @brief flush_java_batch Deliver pending calls of a batched method, one batch per run.
+ */
+static void flush_java_batch(qi_method_info* info)
+{
+  qi_batch_info& batch = *info->batch;
+  std::vector<qi_batch_info::Call> calls;
+  {
+    boost::mutex::scoped_lock lock(batch.mutex);
+    while (!batch.pending.empty() && (!batch.maxBatchSize || calls.size() < batch.maxBatchSize))
+    {
+      calls.push_back(batch.pending.front());
+      batch.pending.pop_front();
+    }
+  }
+
+  if (!calls.empty())
+  {
+    try
+    {
+      qi::jni::JNIAttach attach;
+      call_java_batch(attach.get(), info, calls);
+    }
+    catch (std::exception& e)
+    {
+      for (size_t i = 0; i < calls.size(); ++i)
+        set_error_once(calls[i].second, e.what());
+    }
+    for (size_t i = 0; i < calls.size(); ++i)
+      calls[i].first.destroy();
+  }
+
+  // Calls received meanwhile make the next batch.
+  {
+    boost::mutex::scoped_lock lock(batch.mutex);
+    if (batch.pending.empty())
+    {
+      batch.scheduled = false;
+      return;
+    }
+  }
+  queue_java_batch(info);
+}
+
+/**
+ * @brief batch_to_java Queue a call of a batched method.
+ * @return future of the call, completed once its batch is delivered
+ */
+static qi::AnyReference batch_to_java(qi_method_info* info, const qi::GenericFunctionParameters& params)
+{
+  qi_batch_info& batch = *info->batch;
+  qi::Promise<qi::AnyValue> promise;
+  bool schedule;
+  {
+    boost::mutex::scoped_lock lock(batch.mutex);
+    batch.pending.push_back(std::make_pair(params.copy(), promise));
+    schedule = !batch.scheduled;
+    batch.scheduled = true;
+  }
+
+  // Calls received until the delivery task runs are delivered together.
+  if (schedule)
+    queue_java_batch(info);
+  return qi::AnyReference::from(promise.future()).clone();
+}
+
+/**
+ * @brief dispatch_to_java Run Java method in current thread, or queue it on service executor.
+ * @return result of the method, a qi::Future<qi::AnyValue> if it completes asynchronously
+ */
+static qi::AnyReference dispatch_to_java(const std::string& signature, qi_method_info* info, const qi::GenericFunctionParameters& params)
+{
+  if (info->batch)
+    return batch_to_java(info, params);
+
+  bool useExecutor = info->service && boost::atomic_load(&info->service->executor);
+  boost::shared_ptr<qi::AdmissionControl> admission;
+  if (info->service)
+    admission = info->service->admission;
+
+  bool hasDeadline = info->deadline.count() > 0;
+
+  // qimessaging orders calls itself, unless methods of the object have their own concurrency.
+  int concurrency = java_concurrency(info, params);
+  bool ordered = info->service && info->service->nativeLocking && concurrency != JavaConcurrency_Concurrent;
+
+  if (!useExecutor && !info->cancellable && !admission && !hasDeadline && !ordered)
+    return call_java_method(signature, info, params);
+
+  // Queue the call and release this thread, the call completes with the
+  // returned future. A cancellable method runs asynchronously even without
+  // executor: cancel requests can only reach a call that has returned its future.
+  // Calls of a strand wait for calls with an equal key.
+  boost::shared_ptr<qi::jni::CallContext> context;
+  qi::Promise<qi::AnyValue> promise;
+  if (info->cancellable || hasDeadline)
+  {
+    context.reset(new qi::jni::CallContext());
+    promise = qi::Promise<qi::AnyValue>(boost::bind(&request_cancel, context, _1));
+  }
+  if (hasDeadline)
+  {
+    // Deadline runs from reception: time spent waiting in queues counts.
+    qi::uint64_t timer = java_timer_wheel()->schedule(info->deadline, boost::bind(&expire_call_to_java, context, promise));
+    promise.future().connect(boost::bind(&cancel_deadline, timer));
+  }
+
+  qi::AnyValue key;
+  if (concurrency == JavaConcurrency_Strand)
+    key = AnyValue_native_copy(params[info->strandKey]);
+
+  qi::GenericFunctionParameters args = params.copy();
+  boost::function<void ()> task = boost::bind(&call_java_method_task, signature, info, args, promise, context);
+  if (admission)
+  {
+    // Rejected calls fail right away, through their promise.
+    boost::function<void ()> admitted = boost::bind(&admitted_java_task, admission, task, promise.future());
+    boost::function<void ()> drop = boost::bind(&drop_java_call, admission, promise, args);
+    admission->submit(boost::bind(&queue_java_task, info, concurrency, key, admitted, drop),
+                      boost::bind(&reject_java_call, promise, args, _1));
+  }
+  else if (!queue_java_task(info, concurrency, key, task,
+                            boost::bind(&drop_java_call, boost::shared_ptr<qi::AdmissionControl>(), promise, args)))
+  {
+    args.destroy();
+    throw std::runtime_error("Service executor queue is full");
+  }
+  return qi::AnyReference::from(promise.future()).clone();
+}
+
+/**
+ * @brief call_to_java Heller function to call Java methods.
+ * @param signature qitype signature formated
+ * @param data pointer on a qi_method_info (which hold Java object class and reference)
+ * @param params parameters to forward to called method
+ * @return
+ */
+qi::AnyReference call_to_java(std::string signature, void* data, const qi::GenericFunctionParameters& params)
+{
+  qi_method_info*     info = reinterpret_cast<qi_method_info*>(data);
+
+  // Check value of method info structure
+  if (info == 0)
+  {
+    qi::jni::JNIAttach attach;
+    qiLogError() << "Internal method informations are not valid";
+    throwJavaError(attach.get(), "Internal method informations are not valid");
+    return qi::AnyReference();
+  }
+
+  if (!info->memo)
+    return dispatch_to_java(signature, info, params);
 
+  // Memoized method: serve cached result without entering the JVM.
+  // It is a native copy, each Java caller gets its own Java objects.
+  std::string key = qi::MemoCache::key(params);
+  qi::AnyValue cached;
+  if (info->memo->get(key, cached))
+    return cached.release();
+
+  qi::AnyReference res = dispatch_to_java(signature, info, params);
+  if (res.type() && res.type()->info() == qi::typeOf<qi::Future<qi::AnyValue> >()->info())
+    res.ptr<qi::Future<qi::AnyValue> >(false)->connect(boost::bind(&memoize_result, info->memo, key, _1));
+  else
+    info->memo->put(key, AnyValue_native_copy(res));
   return res;
 }
 
@@ -209,3 +1078,164 @@ qi::AnyReference event_callback_to_java(void *vinfo, const std::vector<qi::AnyRe
 
   return call_to_java(info->sig, info, params);
 }
+
+/**
+ * @brief fanout_listener Call one listener of a shared subscription with converted arguments.
+ * @param from signature of the event arguments
+ */
+static void fanout_listener(JNIEnv* env, qi_method_info* info, const qi::Signature& from, std::vector<jvalue>& args,
+                            const qi::GenericFunctionParameters& params)
+{
+  // Primitive or asynchronous listeners take their own path, converting their arguments again.
+  if (!info->mid || info->kind != JavaMethod_Boxed)
+  {
+    try
+    {
+      qi::AnyReference res = call_to_java(info->sig, info, params);
+      res.destroy();
+    }
+    catch (std::exception& e)
+    {
+      qiLogError() << "Event callback failed: " << e.what();
+    }
+    return;
+  }
+
+  std::vector<std::string> sigInfo = qi::signatureSplit(info->sig);
+  if (from.isConvertibleTo(qi::Signature(sigInfo[2])) == 0)
+  {
+    qiLogError() << "Event callback failed: cannot convert parameters from " << from.toString() << " to " << sigInfo[2];
+    return;
+  }
+
+  jvalue* values = args.empty() ? 0 : &args[0];
+  if (sigInfo[0] == "" || sigInfo[0] == "v")
+    env->CallVoidMethodA(info->instance, info->mid, values);
+  else
+    qi::jni::releaseObject(env->CallObjectMethodA(info->instance, info->mid, values));
+
+  if (env->ExceptionCheck())
+    qiLogError() << "Event callback failed: " << qi::jni::javaExceptionMessage(env);
+}
+
+/**
+ * @brief event_fanout_task Give an event to all Java listeners of a shared subscription.
+ */
+static void event_fanout_task(boost::shared_ptr<qi_signal_fanout> fanout, const qi::GenericFunctionParameters& params)
+{
+  // Listeners disconnected meanwhile stay alive until the end of the pass.
+  std::vector<boost::shared_ptr<qi_method_info> > listeners;
+  {
+    boost::mutex::scoped_lock lock(fanout->mutex);
+    listeners = fanout->listeners;
+  }
+  if (listeners.empty())
+    return;
+
+  qi::jni::JNIAttach attach;
+  JNIEnv* env = attach.get();
+
+  // Arguments are converted once, whatever the number of listeners. Those of
+  // a post() in this JVM are Java objects already, given to all listeners as is.
+  std::vector<jvalue> args(params.size());
+  std::string fromSignature = "(";
+  for (unsigned int i = 0; i < params.size(); ++i)
+  {
+    args[i].l = java_argument(env, params[i]);
+    if (params[i].type() == qi::typeOf<jobject>())
+    {
+      std::string signature = qi::jni::qiSignature(env, args[i].l);
+      fromSignature += signature.empty() ? std::string(1, (char) qi::Signature::Type_Dynamic) : signature;
+    }
+    else if (params[i].kind() == qi::TypeKind_Dynamic)
+      fromSignature += (*params[i]).type()->signature().toString();
+    else
+      fromSignature += params[i].type()->signature().toString();
+  }
+  fromSignature += ")";
+
+  qi::Signature from(fromSignature);
+  for (std::vector<boost::shared_ptr<qi_method_info> >::iterator it = listeners.begin(); it != listeners.end(); ++it)
+    fanout_listener(env, it->get(), from, args, params);
+
+  for (unsigned int i = 0; i < args.size(); ++i)
+    qi::jni::releaseObject(args[i].l);
+}
+
+static void event_fanout_posted(boost::shared_ptr<qi_signal_fanout> fanout);
+
+/**
+ * @brief drop_fanout_events Drop pending events of a subscription when no delivery task can be queued.
+ */
+static void drop_fanout_events(boost::shared_ptr<qi_signal_fanout> fanout)
+{
+  std::deque<qi::GenericFunctionParameters> dropped;
+  {
+    boost::mutex::scoped_lock lock(fanout->mutex);
+    dropped.swap(fanout->pending);
+    fanout->scheduled = false;
+  }
+  for (std::deque<qi::GenericFunctionParameters>::iterator it = dropped.begin(); it != dropped.end(); ++it)
+    it->destroy();
+}
+
+/**
+ * @brief event_fanout_posted Deliver the oldest pending event of a prioritized subscription.
+ * A single delivery task per subscription is queued at a time: events never
+ * overlap nor overtake each other, whatever the number of dispatcher threads.
+ */
+static void event_fanout_posted(boost::shared_ptr<qi_signal_fanout> fanout)
+{
+  qi::GenericFunctionParameters params;
+  {
+    boost::mutex::scoped_lock lock(fanout->mutex);
+    if (fanout->pending.empty())
+    {
+      fanout->scheduled = false;
+      return;
+    }
+    params = fanout->pending.front();
+    fanout->pending.pop_front();
+  }
+
+  event_fanout_task(fanout, params);
+  params.destroy();
+
+  // One event per run: callbacks of higher priority lanes run in between.
+  {
+    boost::mutex::scoped_lock lock(fanout->mutex);
+    if (fanout->pending.empty())
+    {
+      fanout->scheduled = false;
+      return;
+    }
+  }
+  if (!java_dispatcher()->post(boost::bind(&event_fanout_posted, fanout), fanout->lane))
+    drop_fanout_events(fanout);
+}
+
+qi::AnyReference event_fanout_to_java(boost::weak_ptr<qi_signal_fanout> weakFanout, const std::vector<qi::AnyReference>& params)
+{
+  boost::shared_ptr<qi_signal_fanout> fanout = weakFanout.lock();
+  if (!fanout)
+    return qi::AnyReference(qi::typeOf<void>());
+
+  if (fanout->lane < 0)
+  {
+    event_fanout_task(fanout, qi::GenericFunctionParameters(params));
+    return qi::AnyReference(qi::typeOf<void>());
+  }
+
+  // Prioritized subscription: release emitting thread, dispatcher runs
+  // callbacks of higher priority lanes first.
+  bool schedule;
+  {
+    boost::mutex::scoped_lock lock(fanout->mutex);
+    fanout->pending.push_back(qi::GenericFunctionParameters(params).copy());
+    schedule = !fanout->scheduled;
+    fanout->scheduled = true;
+  }
+  if (schedule && !java_dispatcher()->post(boost::bind(&event_fanout_posted, fanout), fanout->lane))
+    drop_fanout_events(fanout);
+  return qi::AnyReference(qi::typeOf<void>());
+}
@@ -0,0 +1,126 @@
+/*
+**
+** Copyright (C) 2015 Aldebaran Robotics
+** See COPYING for the license
+*/
+
+#include <boost/bind.hpp>
+
+#include <callgate.hpp>
+
+namespace qi {
+
+  CallGate::CallGate()
+    : _running(0)
+    , _exclusive(false)
+  {
+  }
+
+  bool CallGate::canRun(bool exclusive) const
+  {
+    if (exclusive)
+      return !_exclusive && _running == 0;
+    return !_exclusive;
+  }
+
+  void CallGate::admit(const Call& call, Calls& ready)
+  {
+    // Calls already waiting go first.
+    if (!_waiting.empty() || !canRun(call.exclusive))
+    {
+      _waiting.push_back(call);
+      return;
+    }
+
+    if (call.exclusive)
+      _exclusive = true;
+    else
+      ++_running;
+    ready.push_back(call);
+  }
+
+  void CallGate::submit(bool exclusive, const qi::AnyValue* key, const Task& task, const Post& post, const Task& drop)
+  {
+    Call call;
+    call.task = task;
+    call.post = post;
+    call.drop = drop;
+    call.exclusive = exclusive;
+    call.strand = (key != 0);
+    if (key)
+      call.key = *key;
+
+    Calls ready;
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+      if (call.strand)
+      {
+        // A call with the same key is in flight: wait for it to finish.
+        std::map<qi::AnyValue, std::deque<Call> >::iterator it = _strands.find(call.key);
+        if (it != _strands.end())
+        {
+          it->second.push_back(call);
+          return;
+        }
+        _strands[call.key];
+      }
+      admit(call, ready);
+    }
+    start(ready);
+  }
+
+  void CallGate::start(const Calls& ready)
+  {
+    for (Calls::const_iterator it = ready.begin(); it != ready.end(); ++it)
+    {
+      if (it->post(boost::bind(&CallGate::run, shared_from_this(), *it)))
+        continue;
+      it->drop();
+      finish(*it);
+    }
+  }
+
+  void CallGate::run(const Call& call)
+  {
+    call.task();
+    finish(call);
+  }
+
+  void CallGate::finish(const Call& call)
+  {
+    Calls ready;
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+      if (call.exclusive)
+        _exclusive = false;
+      else
+        --_running;
+
+      while (!_waiting.empty() && canRun(_waiting.front().exclusive))
+      {
+        if (_waiting.front().exclusive)
+          _exclusive = true;
+        else
+          ++_running;
+        ready.push_back(_waiting.front());
+        _waiting.pop_front();
+      }
+
+      // Next call of the strand goes after the calls already waiting.
+      if (call.strand)
+      {
+        std::map<qi::AnyValue, std::deque<Call> >::iterator it = _strands.find(call.key);
+        if (it->second.empty())
+          _strands.erase(it);
+        else
+        {
+          Call next = it->second.front();
+          it->second.pop_front();
+          admit(next, ready);
+        }
+      }
+    }
+    start(ready);
+  }
+
+} // !qi
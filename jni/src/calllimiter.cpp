@@ -0,0 +1,152 @@
+/*
+**
+** Copyright (C) 2015 Aldebaran Robotics
+** See COPYING for the license
+*/
+
+#include <vector>
+
+#include <calllimiter.hpp>
+
+namespace qi {
+
+  CallLimiter::CallLimiter()
+    : _nextTicket(1)
+    , _maxInFlight(0)
+    , _maxBytes(0)
+    , _overflow(Overflow_FailFast)
+    , _bytes(0)
+    , _rejected(0)
+    , _dropped(0)
+  {
+  }
+
+  void CallLimiter::setLimits(unsigned int maxInFlight, size_t maxBytes, Overflow overflow)
+  {
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+      _maxInFlight = maxInFlight;
+      _maxBytes = maxBytes;
+      _overflow = overflow;
+    }
+    // Blocked callers check new limits.
+    _cond.notify_all();
+  }
+
+  bool CallLimiter::limitsBytes()
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    return _maxBytes != 0;
+  }
+
+  bool CallLimiter::hasRoom(size_t bytes) const
+  {
+    if (_calls.empty())
+      return true; // A single call is always admitted, whatever its size.
+    if (_maxInFlight && _calls.size() >= _maxInFlight)
+      return false;
+    return !_maxBytes || _bytes + bytes <= _maxBytes;
+  }
+
+  qi::uint64_t CallLimiter::admit(size_t bytes, qi::Promise<qi::AnyValue> promise, const Stop& stop)
+  {
+    std::vector<Call> dropped;
+    qi::uint64_t ticket;
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+
+      while (!hasRoom(bytes))
+      {
+        if (_overflow == Overflow_FailFast)
+        {
+          ++_rejected;
+          return 0;
+        }
+
+        if (_overflow == Overflow_Block)
+        {
+          _cond.wait(lock);
+          continue;
+        }
+
+        std::map<qi::uint64_t, Call>::iterator oldest = _calls.begin();
+        dropped.push_back(oldest->second);
+        _bytes -= oldest->second.bytes;
+        _calls.erase(oldest);
+        ++_dropped;
+      }
+
+      ticket = _nextTicket++;
+      Call& call = _calls[ticket];
+      call.bytes = bytes;
+      call.promise = promise;
+      call.stop = stop;
+      _bytes += bytes;
+    }
+
+    // Finish dropped calls out of lock: their callbacks may call again.
+    for (std::vector<Call>::iterator it = dropped.begin(); it != dropped.end(); ++it)
+    {
+      try
+      {
+        it->promise.setError("Call dropped: too many calls in flight");
+      }
+      catch (std::exception&)
+      {
+        continue; // Finished concurrently
+      }
+      // Nobody waits for its result anymore, stop the call itself.
+      if (it->stop)
+        it->stop();
+    }
+    return ticket;
+  }
+
+  void CallLimiter::finish(qi::uint64_t ticket)
+  {
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+      std::map<qi::uint64_t, Call>::iterator it = _calls.find(ticket);
+
+      // Already dropped
+      if (it == _calls.end())
+        return;
+      _bytes -= it->second.bytes;
+      _calls.erase(it);
+    }
+    // Blocked callers wait for room of different sizes: each one checks again.
+    _cond.notify_all();
+  }
+
+  CallLimiter::Counters CallLimiter::counters()
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    Counters counters;
+
+    counters.inFlight = _calls.size();
+    counters.bytes = _bytes;
+    counters.rejected = _rejected;
+    counters.dropped = _dropped;
+    return counters;
+  }
+
+} // !qi
+
+jlongArray java_call_counters(JNIEnv* env, boost::shared_ptr<qi::CallLimiter> limiter)
+{
+  jlong values[4] = { 0, 0, 0, 0 };
+
+  if (limiter)
+  {
+    qi::CallLimiter::Counters counters = limiter->counters();
+    values[0] = counters.inFlight;
+    values[1] = counters.bytes;
+    values[2] = counters.rejected;
+    values[3] = counters.dropped;
+  }
+
+  jlongArray array = env->NewLongArray(4);
+  if (array)
+    env->SetLongArrayRegion(array, 0, 4, values);
+  return array;
+}
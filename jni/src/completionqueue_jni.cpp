@@ -0,0 +1,186 @@
+/*
+**
+** Copyright (C) 2015 Aldebaran Robotics
+** See COPYING for the license
+*/
+
+#include <algorithm>
+#include <vector>
+#include <boost/bind.hpp>
+#include <qi/log.hpp>
+
+#include <jnitools.hpp>
+#include <futurehandler.hpp>
+#include <future_jni.hpp>
+#include <handletable.hpp>
+#include <completionqueue_jni.hpp>
+
+qiLogCategory("qimessaging.jni");
+
+/**
+ * @brief gQueueHandles Queues held by com.aldebaran.qi.CompletionQueue instances.
+ * Natives hold a reference while they run: closing a queue while a thread drains it is safe.
+ */
+static qi::HandleTable<boost::shared_ptr<qi::CompletionQueue> > gQueueHandles;
+
+/**
+ * @brief java_queue Queue of a Java handle, throw a Java exception and return an empty pointer if it is closed.
+ */
+static boost::shared_ptr<qi::CompletionQueue> java_queue(JNIEnv* env, jlong handle)
+{
+  boost::shared_ptr<qi::CompletionQueue> queue;
+
+  if (!gQueueHandles.get(handle, queue))
+    throwJavaError(env, "CompletionQueue is closed");
+  return queue;
+}
+
+namespace qi {
+
+  CompletionQueue::CompletionQueue()
+    : _state(new State())
+  {
+  }
+
+  CompletionQueue::~CompletionQueue()
+  {
+    close();
+  }
+
+  void CompletionQueue::close()
+  {
+    {
+      boost::mutex::scoped_lock lock(_state->mutex);
+      _state->closed = true;
+    }
+    _state->cond.notify_all();
+  }
+
+  bool CompletionQueue::add(qi::Future<qi::AnyValue> future, jlong tag)
+  {
+    {
+      boost::mutex::scoped_lock lock(_state->mutex);
+      // A second result for the tag would overwrite the first one.
+      if (!_state->tags.insert(tag).second)
+        return false;
+    }
+    future.connect(boost::bind(&CompletionQueue::push, boost::weak_ptr<State>(_state), tag, _1));
+    return true;
+  }
+
+  void CompletionQueue::push(boost::weak_ptr<State> weakState, jlong tag, qi::Future<qi::AnyValue> future)
+  {
+    boost::shared_ptr<State> state = weakState.lock();
+    if (!state)
+      return;
+
+    {
+      boost::mutex::scoped_lock lock(state->mutex);
+      state->results[tag] = future;
+      state->finished.push_back(tag);
+    }
+    state->cond.notify_one();
+  }
+
+  int CompletionQueue::drain(jlong* tags, int max, qi::MilliSeconds timeout)
+  {
+    boost::shared_ptr<State> state = _state;
+    boost::mutex::scoped_lock lock(state->mutex);
+
+    qi::SteadyClock::time_point deadline = qi::SteadyClock::now() + timeout;
+    while (state->finished.empty() && !state->closed)
+    {
+      if (timeout.count() < 0)
+      {
+        state->cond.wait(lock);
+        continue;
+      }
+
+      qi::SteadyClock::time_point now = qi::SteadyClock::now();
+      if (now >= deadline)
+        break;
+      state->cond.wait_for(lock, deadline - now);
+    }
+
+    int count = std::min(max, (int) state->finished.size());
+    std::copy(state->finished.begin(), state->finished.begin() + count, tags);
+    state->finished.erase(state->finished.begin(), state->finished.begin() + count);
+    return count;
+  }
+
+  bool CompletionQueue::take(jlong tag, qi::Future<qi::AnyValue>& future)
+  {
+    boost::mutex::scoped_lock lock(_state->mutex);
+    boost::unordered_map<jlong, qi::Future<qi::AnyValue> >::iterator it = _state->results.find(tag);
+
+    if (it == _state->results.end())
+      return false;
+    future = it->second;
+    _state->results.erase(it);
+    _state->tags.erase(tag);
+    return true;
+  }
+
+} // !qi
+
+jlong Java_com_aldebaran_qi_CompletionQueue_create(JNIEnv* env, jclass QI_UNUSED(cls))
+{
+  // Future of taken results are created from any Java thread.
+  qi::FutureHandler::init(env);
+  return gQueueHandles.add(boost::shared_ptr<qi::CompletionQueue>(new qi::CompletionQueue()));
+}
+
+void Java_com_aldebaran_qi_CompletionQueue_destroy(JNIEnv* QI_UNUSED(env), jclass QI_UNUSED(cls), jlong pQueue)
+{
+  boost::shared_ptr<qi::CompletionQueue> queue;
+
+  // Closed queues are released again when collected: stale handles are ignored.
+  if (!gQueueHandles.get(pQueue, queue) || !gQueueHandles.remove(pQueue))
+    return;
+  // Threads draining it return now, the last of them deletes it.
+  queue->close();
+}
+
+void Java_com_aldebaran_qi_CompletionQueue_add(JNIEnv* env, jclass QI_UNUSED(cls), jlong pQueue, jlong pFuture, jlong tag)
+{
+  boost::shared_ptr<qi::CompletionQueue> queue = java_queue(env, pQueue);
+  qi::Future<qi::AnyValue> future;
+
+  if (!queue)
+    return;
+  if (!java_future_from_handle(pFuture, future))
+  {
+    throwJavaError(env, "Future is closed");
+    return;
+  }
+  if (!queue->add(future, tag))
+    throwJavaError(env, "Tag is already used by a future not taken yet");
+}
+
+jint Java_com_aldebaran_qi_CompletionQueue_drain(JNIEnv* env, jclass QI_UNUSED(cls), jlong pQueue, jlongArray tags, jint max, jlong timeoutMs)
+{
+  boost::shared_ptr<qi::CompletionQueue> queue = java_queue(env, pQueue);
+  if (!queue)
+    return 0;
+
+  jsize size = env->GetArrayLength(tags);
+  std::vector<jlong> drained(std::max(0, std::min((int) size, (int) max)));
+
+  if (drained.empty())
+    return 0;
+
+  int count = queue->drain(&drained[0], drained.size(), qi::MilliSeconds(timeoutMs));
+  if (count)
+    env->SetLongArrayRegion(tags, 0, count, &drained[0]);
+  return count;
+}
+
+jobject Java_com_aldebaran_qi_CompletionQueue_take(JNIEnv* env, jclass QI_UNUSED(cls), jlong pQueue, jlong tag)
+{
+  boost::shared_ptr<qi::CompletionQueue> queue = java_queue(env, pQueue);
+  qi::Future<qi::AnyValue> future;
+
+  if (!queue || !queue->take(tag, future))
+    return 0;
+  return qi::FutureHandler::futurePointer(env, future);
+}
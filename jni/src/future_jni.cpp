@@ -8,73 +8,137 @@
 */
 
 #include <qi/anyvalue.hpp>
+#include <qi/atomic.hpp>
 
 #include <jnitools.hpp>
 #include <futurehandler.hpp>
 #include <future_jni.hpp>
+#include <handletable.hpp>
 #include <callbridge.hpp>
+#include <priority_jni.hpp>
 
 qiLogCategory("qimessaging.java");
 
-void      java_future_callback(const qi::Future<qi::AnyValue>& future)
+/**
+ * @brief java_future_callback Call Java callback of a finished future.
+ * @param info callback bound to the future continuation, deleted once called
+ */
+static void java_future_callback(const qi::Future<qi::AnyValue>& future, qi::CallbackInfo* info)
 {
-  JNIEnv *env = 0;
-  jclass  cls = 0;
+  {
+    qi::jni::JNIAttach attach;
+    JNIEnv* env = attach.get();
 
-  qi::jni::JNIAttach attach;
-  env = attach.get();
+    if (future.hasError()) // Call onFailure
+      qi::FutureHandler::onFailure(env, future, info);
 
-  // Get Java information related to Java callback
-  qi::CallbackInfo* info = qi::FutureHandler::methodInfo(future);
-  if ((cls = env->FindClass(info->className.c_str())) == 0)
-  {
-    qiLogError() << "Cannot find com.aldebaran.qimessaging.Callback implementation";
-    throw new std::runtime_error("Cannot find com.aldebaran.qimessaging.Callback interface");
+    if (!future.hasError() && future.isFinished()) // Call onSuccess
+      qi::FutureHandler::onSuccess(env, future, info);
+
+    if (future.isFinished()) // Call onCompleted
+      qi::FutureHandler::onComplete(env, future, info);
   }
 
-  if (future.hasError()) // Call onFailure
-    qi::FutureHandler::onFailure(env, cls, info);
+  // Only called once
+  delete info;
+}
 
-  if (!future.hasError() && future.isFinished()) // Call onSuccess
-    qi::FutureHandler::onSuccess(env, cls, info);
+/**
+ * @brief gFutureHandles C++ futures held by com.aldebaran.qi.Future instances.
+ */
+static qi::HandleTable<qi::Future<qi::AnyValue> > gFutureHandles;
 
-  if (future.isFinished()) // Call onCompleted
-    qi::FutureHandler::onComplete(env, cls, info);
+jlong java_future_handle(const qi::Future<qi::AnyValue>& future)
+{
+  return gFutureHandles.add(future);
+}
 
-  // Only called once, so remove and delete info
-  qi::FutureHandler::removeCallbackInfo(future);
+bool java_future_from_handle(jlong handle, qi::Future<qi::AnyValue>& future)
+{
+  return gFutureHandles.get(handle, future);
+}
+
+/**
+ * @brief java_future Get the C++ future held by a com.aldebaran.qi.Future
+ * @param env JNI environment
+ * @param future com.aldebaran.qi.Future instance
+ * @param result C++ future
+ * @return false if future is null or closed
+ */
+bool java_future(JNIEnv* env, jobject future, qi::Future<qi::AnyValue>& result)
+{
+  if (!future)
+    return false;
+
+  jclass cls = env->GetObjectClass(future);
+  jfieldID fid = env->GetFieldID(cls, "_fut", "J");
   env->DeleteLocalRef(cls);
+  if (!fid)
+  {
+    env->ExceptionClear();
+    qiLogError() << "Cannot get C++ future of " QI_FUTURE_CLASS;
+    return false;
+  }
+
+  return gFutureHandles.get(env->GetLongField(future, fid), result);
+}
+
+/**
+ * @brief future_of_handle Future of a handle given by Java, throw a Java exception if it is closed.
+ */
+static bool future_of_handle(JNIEnv* env, jlong handle, qi::Future<qi::AnyValue>& future)
+{
+  if (gFutureHandles.get(handle, future))
+    return true;
+  throwJavaError(env, "Future is closed");
+  return false;
 }
 
 jboolean  Java_com_aldebaran_qi_Future_qiFutureCallCancel(JNIEnv *env, jobject obj, jlong pFuture, jboolean mayInterup)
 {
-  qi::Future<qi::AnyValue>* fut = reinterpret_cast<qi::Future<qi::AnyValue>*>(pFuture);
+  qi::Future<qi::AnyValue> fut;
+  if (!future_of_handle(env, pFuture, fut))
+    return false;
 
-  if (fut->isCancelable() == false)
+  if (fut.isCancelable() == false)
     return false;
 
-  fut->cancel();
+  fut.cancel();
   return true;
 }
 
+/**
+ * @brief java_future_value Value of a future as a Java object, waiting for it if needed.
+ * @return local reference, throws std::runtime_error if future has an error
+ */
+static jobject java_future_value(JNIEnv* env, const qi::Future<qi::AnyValue>& future)
+{
+  qi::AnyReference arRes = future.value().asReference();
+  std::pair<qi::AnyReference, bool> converted = arRes.convert(qi::typeOf<jobject>());
+  jobject result = * (jobject*)converted.first.rawValue();
+  // keep it alive while we remove the global ref
+  result = env->NewLocalRef(result);
+  if (converted.second)
+    converted.first.destroy();
+  return result;
+}
+
 jobject  Java_com_aldebaran_qi_Future_qiFutureCallGet(JNIEnv *env, jobject obj, jlong pFuture)
 {
-  qi::Future<qi::AnyValue>* fut = reinterpret_cast<qi::Future<qi::AnyValue>*>(pFuture);
+  qi::Future<qi::AnyValue> fut;
+  if (!future_of_handle(env, pFuture, fut))
+    return 0;
 
   try
   {
-    qi::AnyReference arRes = fut->value().asReference();
-    std::pair<qi::AnyReference, bool> converted = arRes.convert(qi::typeOf<jobject>());
-    jobject result = * (jobject*)converted.first.rawValue();
-    // keep it alive while we remove the global ref
-    result = env->NewLocalRef(result);
-    if (converted.second)
-      converted.first.destroy();
-    return result;
+    return java_future_value(env, fut);
   }
   catch (std::runtime_error &e)
   {
-    throwJavaError(env, e.what());
+    if (fut.isCanceled())
+      qi::jni::throwCallError(env, "Call canceled", qi::jni::CallError_Cancelled);
+    else
+      qi::jni::throwCallError(env, e.what(), qi::jni::callErrorKind(e.what()));
     return 0;
   }
 }
@@ -82,17 +146,22 @@ jobject  Java_com_aldebaran_qi_Future_qiFutureCallGet(JNIEnv *env, jobject obj,
 jobject  Java_com_aldebaran_qi_Future_qiFutureCallGetWithTimeout(JNIEnv *env, jobject obj, jlong pFuture, jint timeout)
 {
   qiLogVerbose() << "Future wait " << timeout;
-  qi::Future<qi::AnyValue>* fut = reinterpret_cast<qi::Future<qi::AnyValue>*>(pFuture);
+  qi::Future<qi::AnyValue> fut;
+  if (!future_of_handle(env, pFuture, fut))
+    return 0;
 
-  qi::FutureState status = fut->wait(timeout);
+  qi::FutureState status = fut.wait(timeout);
   qiLogVerbose() << "Waited, got " << status;
   switch(status) {
   case qi::FutureState_FinishedWithValue:
     return Java_com_aldebaran_qi_Future_qiFutureCallGet(env, obj, pFuture);
   case qi::FutureState_Running:
     return 0;
+  case qi::FutureState_Canceled:
+    qi::jni::throwCallError(env, "Call canceled", qi::jni::CallError_Cancelled);
+    break;
   default:
-    throwJavaError(env, fut->error().c_str());
+    qi::jni::throwCallError(env, fut.error(), qi::jni::callErrorKind(fut.error()));
   }
 
   return 0;
@@ -100,44 +169,449 @@ jobject  Java_com_aldebaran_qi_Future_qiFutureCallGetWithTimeout(JNIEnv *env, jo
 
 jboolean Java_com_aldebaran_qi_Future_qiFutureCallIsCancelled(JNIEnv *env, jobject obj, jlong pFuture)
 {
-  qi::Future<qi::AnyValue>* fut = reinterpret_cast<qi::Future<qi::AnyValue>*>(pFuture);
+  qi::Future<qi::AnyValue> fut;
+  if (!future_of_handle(env, pFuture, fut))
+    return false;
 
-  return fut->isCanceled();
+  return fut.isCanceled();
 }
 
 jboolean Java_com_aldebaran_qi_Future_qiFutureCallIsDone(JNIEnv *env, jobject obj, jlong pFuture)
 {
-  qi::Future<qi::AnyValue>* fut = reinterpret_cast<qi::Future<qi::AnyValue>*>(pFuture);
+  qi::Future<qi::AnyValue> fut;
+  if (!future_of_handle(env, pFuture, fut))
+    return false;
 
-  return fut->isFinished();
+  return fut.isFinished();
 }
 
-jboolean Java_com_aldebaran_qi_Future_qiFutureCallConnect(JNIEnv *env, jobject obj, jlong pFuture, jobject callback, jstring jclassName, jobjectArray args)
+/**
+ * @brief java_future_dispatch Queue Java callback of a finished future on the dispatcher lane.
+ */
+static void java_future_dispatch(const qi::Future<qi::AnyValue>& future, int lane, qi::CallbackInfo* info)
 {
-  qi::Future<qi::AnyValue>* fut = reinterpret_cast<qi::Future<qi::AnyValue>*>(pFuture);
+  if (java_dispatcher()->post(boost::bind(&java_future_callback, future, info), lane))
+    return;
+  qiLogError() << "Cannot dispatch future callback";
+  delete info;
+}
+
+jboolean Java_com_aldebaran_qi_Future_qiFutureCallConnect(JNIEnv *env, jobject obj, jlong pFuture, jobject callback, jstring jclassName, jobjectArray args, jint lane)
+{
+  qi::Future<qi::AnyValue> fut;
+  if (!future_of_handle(env, pFuture, fut))
+    return false;
   std::string className = qi::jni::toString(jclassName);
   qi::CallbackInfo* info = 0;
 
   qi::jni::JNIAttach attach(env);
 
-  info = new qi::CallbackInfo(callback, args, className);
-  qi::FutureHandler::addCallbackInfo(fut, info);
-  fut->connect(boost::bind(&java_future_callback, _1));
+  qi::FutureHandler::init(env);
+  info = new qi::CallbackInfo(env, callback, args, className);
+  if (lane < 0)
+    fut.connect(boost::bind(&java_future_callback, _1, info));
+  else
+    fut.connect(boost::bind(&java_future_dispatch, _1, lane, info));
+  return true;
+}
+
+/**
+ * @brief The JavaContinuation struct Java function or adapter bound to a future continuation.
+ * The value is converted in the thread finishing the future, no Java thread waits for it.
+ */
+struct JavaContinuation
+{
+  enum Kind
+  {
+    Continuation_Future, // com.aldebaran.qi.Function called with the finished Future
+    Continuation_Value, // com.aldebaran.qi.Function called with the value, errors are forwarded
+    Continuation_Adapter // FutureAdapter, or Future converted eagerly, completed with the value or the error
+  };
+
+  Kind                      kind;
+  jobject                   target;
+  jmethodID                 execute; // Function.execute or FutureAdapter.complete
+  jmethodID                 fail; // FutureAdapter.fail
+  qi::Promise<qi::AnyValue> promise; // Result of the function
+
+  JavaContinuation(JNIEnv* env, Kind kind, jobject target, qi::Promise<qi::AnyValue> promise = qi::Promise<qi::AnyValue>())
+    : kind(kind)
+    , target(env->NewGlobalRef(target))
+    , fail(0)
+    , promise(promise)
+  {
+    jclass cls = env->GetObjectClass(target);
+    if (kind == Continuation_Adapter)
+    {
+      execute = env->GetMethodID(cls, "complete", "(Ljava/lang/Object;)V");
+      fail = env->GetMethodID(cls, "fail", "(Ljava/lang/Throwable;)V");
+    }
+    else
+      execute = env->GetMethodID(cls, "execute", "(Ljava/lang/Object;)Ljava/lang/Object;");
+    if (env->ExceptionCheck())
+      env->ExceptionClear();
+    env->DeleteLocalRef(cls);
+  }
+
+  ~JavaContinuation()
+  {
+    // May be destroyed in a qimessaging thread
+    qi::jni::JNIAttach attach;
+    attach.get()->DeleteGlobalRef(target);
+  }
+};
+
+static void java_adapter_fail(JNIEnv* env, JavaContinuation* cont, const std::string& error, qi::jni::CallErrorKind kind)
+{
+  jthrowable exception = qi::jni::newCallError(env, error, kind);
+  env->CallVoidMethod(cont->target, cont->fail, exception);
+  env->DeleteLocalRef(exception);
+}
+
+/**
+ * @brief java_future_adapter Complete a FutureAdapter with the result of future.
+ */
+static void java_future_adapter(JNIEnv* env, const qi::Future<qi::AnyValue>& future, JavaContinuation* cont)
+{
+  if (future.isCanceled())
+    java_adapter_fail(env, cont, "Call canceled", qi::jni::CallError_Cancelled);
+  else if (future.hasError())
+    java_adapter_fail(env, cont, future.error(), qi::jni::callErrorKind(future.error()));
+  else
+  {
+    try
+    {
+      jobject value = java_future_value(env, future);
+      env->CallVoidMethod(cont->target, cont->execute, value);
+      env->DeleteLocalRef(value);
+    }
+    catch (std::exception& e)
+    {
+      java_adapter_fail(env, cont, e.what(), qi::jni::CallError_Conversion);
+    }
+  }
+
+  if (env->ExceptionCheck())
+    qiLogError() << "FutureAdapter: " << qi::jni::javaExceptionMessage(env);
+}
+
+/**
+ * @brief java_future_function Call Java function of a continuation, and set its promise with the result.
+ */
+static void java_future_function(JNIEnv* env, const qi::Future<qi::AnyValue>& future, JavaContinuation* cont)
+{
+  jobject arg = 0;
+
+  if (cont->kind == JavaContinuation::Continuation_Future)
+    arg = qi::FutureHandler::futurePointer(env, future);
+  else if (future.isCanceled())
+  {
+    cont->promise.setCanceled();
+    return;
+  }
+  else if (future.hasError())
+  {
+    cont->promise.setError(future.error());
+    return;
+  }
+  else
+  {
+    try
+    {
+      arg = java_future_value(env, future);
+    }
+    catch (std::exception& e)
+    {
+      cont->promise.setError(e.what());
+      return;
+    }
+  }
+
+  jobject result = env->CallObjectMethod(cont->target, cont->execute, arg);
+  env->DeleteLocalRef(arg);
+  if (env->ExceptionCheck())
+  {
+    cont->promise.setError(qi::jni::javaExceptionMessage(env));
+    return;
+  }
+
+  // Keep the Java object as is, it is converted only if the value leaves the JVM.
+  if (result)
+    cont->promise.setValue(qi::AnyValue::from<jobject>(result));
+  else
+    cont->promise.setValue(qi::AnyValue(qi::typeOf<void>()));
+  env->DeleteLocalRef(result);
+}
+
+/**
+ * @brief java_future_continuation Run Java continuation of a finished future.
+ * @param cont continuation bound to the future, deleted once called
+ */
+static void java_future_continuation(const qi::Future<qi::AnyValue>& future, JavaContinuation* cont)
+{
+  {
+    qi::jni::JNIAttach attach;
+    JNIEnv* env = attach.get();
+
+    if (cont->kind == JavaContinuation::Continuation_Adapter)
+      java_future_adapter(env, future, cont);
+    else
+      java_future_function(env, future, cont);
+  }
+
+  delete cont;
+}
+
+static void java_continuation_dispatch(const qi::Future<qi::AnyValue>& future, int lane, JavaContinuation* cont)
+{
+  if (java_dispatcher()->post(boost::bind(&java_future_continuation, future, cont), lane))
+    return;
+  qiLogError() << "Cannot dispatch future continuation";
+  delete cont;
+}
+
+static void connect_continuation(qi::Future<qi::AnyValue>& fut, int lane, JavaContinuation* cont)
+{
+  if (lane < 0)
+    fut.connect(boost::bind(&java_future_continuation, _1, cont));
+  else
+    fut.connect(boost::bind(&java_continuation_dispatch, _1, lane, cont));
+}
+
+/**
+ * @brief cancel_source Canceling a continuation cancels the future it waits for.
+ */
+static void cancel_source(boost::function<void ()> canceler, qi::Promise<qi::AnyValue>& QI_UNUSED(promise))
+{
+  try
+  {
+    canceler();
+  }
+  catch (std::exception&)
+  {
+    // Not cancelable
+  }
+}
+
+jlong Java_com_aldebaran_qi_Future_qiFutureThen(JNIEnv* env, jclass QI_UNUSED(cls), jlong pFuture, jobject function, jboolean withValue, jint lane)
+{
+  qi::Future<qi::AnyValue> fut;
+  if (!future_of_handle(env, pFuture, fut))
+    return 0;
+  // The continuation of fut holds the promise: the promise only holds a weak reference on fut.
+  qi::Promise<qi::AnyValue> promise(boost::bind(&cancel_source, fut.makeCanceler(), _1));
+
+  qi::jni::JNIAttach attach(env);
+
+  qi::FutureHandler::init(env);
+  connect_continuation(fut, lane, new JavaContinuation(env,
+                                                       withValue ? JavaContinuation::Continuation_Value : JavaContinuation::Continuation_Future,
+                                                       function, promise));
+  return java_future_handle(promise.future());
+}
+
+void Java_com_aldebaran_qi_Future_qiFutureCallComplete(JNIEnv* env, jclass QI_UNUSED(cls), jlong pFuture, jobject adapter, jint lane)
+{
+  qi::Future<qi::AnyValue> fut;
+  if (!future_of_handle(env, pFuture, fut))
+    return;
+
+  qi::jni::JNIAttach attach(env);
+
+  connect_continuation(fut, lane, new JavaContinuation(env, JavaContinuation::Continuation_Adapter, adapter));
+}
+
+/**
+ * @brief java_futures C++ futures of a Java array of future pointers.
+ */
+static std::vector<qi::Future<qi::AnyValue> > java_futures(JNIEnv* env, jlongArray pFutures)
+{
+  std::vector<qi::Future<qi::AnyValue> > futures;
+  jsize size = env->GetArrayLength(pFutures);
+  jlong* pointers = env->GetLongArrayElements(pFutures, 0);
+
+  futures.reserve(size);
+  for (jsize i = 0; i < size; ++i)
+  {
+    qi::Future<qi::AnyValue> future;
+    if (!gFutureHandles.get(pointers[i], future))
+    {
+      qi::Promise<qi::AnyValue> closed;
+      closed.setError("Future is closed");
+      future = closed.future();
+    }
+    futures.push_back(future);
+  }
+  env->ReleaseLongArrayElements(pFutures, pointers, JNI_ABORT);
+  return futures;
+}
+
+/**
+ * @brief when_all Future finished when all futures are, with their finished futures.
+ */
+static qi::Future<std::vector<qi::Future<qi::AnyValue> > > when_all(const std::vector<qi::Future<qi::AnyValue> >& futures)
+{
+  qi::FutureBarrier<qi::AnyValue> barrier;
+
+  for (std::vector<qi::Future<qi::AnyValue> >::const_iterator it = futures.begin(); it != futures.end(); ++it)
+    barrier.addFuture(*it);
+  return barrier.future();
+}
+
+/**
+ * @brief The WhenAll struct Shared by continuations of futures given to whenAll: first error wins.
+ */
+struct WhenAll
+{
+  boost::mutex              mutex;
+  std::vector<qi::AnyValue> values;
+  size_t                    pending; // Futures without value yet
+  bool                      done;
+  qi::Promise<qi::AnyValue> promise;
+};
+
+static void when_all_finished(const qi::Future<qi::AnyValue>& future, boost::shared_ptr<WhenAll> all, size_t index)
+{
+  std::string error;
+  bool failed = false;
+  {
+    boost::mutex::scoped_lock lock(all->mutex);
+    if (all->done)
+      return;
+
+    if (future.isCanceled())
+    {
+      failed = true;
+      error = "Call canceled";
+    }
+    else if (future.hasError())
+    {
+      failed = true;
+      error = future.error();
+    }
+    else
+    {
+      all->values[index] = future.value();
+      if (--all->pending)
+        return;
+    }
+    all->done = true;
+  }
+
+  // Other futures are not waited for once one fails.
+  if (failed)
+    all->promise.setError(error);
+  else
+    all->promise.setValue(qi::AnyValue::from(all->values));
+}
+
+static qi::Future<qi::AnyValue> when_all_values(const std::vector<qi::Future<qi::AnyValue> >& futures)
+{
+  boost::shared_ptr<WhenAll> all(new WhenAll());
+  all->values.resize(futures.size());
+  all->pending = futures.size();
+  all->done = false;
+
+  qi::Future<qi::AnyValue> ret = all->promise.future();
+  if (futures.empty())
+  {
+    all->promise.setValue(qi::AnyValue::from(all->values));
+    return ret;
+  }
+
+  for (size_t i = 0; i < futures.size(); ++i)
+  {
+    qi::Future<qi::AnyValue> future = futures[i];
+    future.connect(boost::bind(&when_all_finished, _1, all, i));
+  }
+  return ret;
+}
+
+/**
+ * @brief The WhenAny struct Shared by continuations of futures given to whenAny: first one wins.
+ */
+struct WhenAny
+{
+  qi::Atomic<int>           done;
+  qi::Promise<qi::AnyValue> promise;
+};
+
+static void when_any_finished(const qi::Future<qi::AnyValue>& QI_UNUSED(future), boost::shared_ptr<WhenAny> any, int index)
+{
+  if (any->done.setIfEquals(0, 1))
+    any->promise.setValue(qi::AnyValue::from(index));
+}
+
+static qi::Future<qi::AnyValue> when_any(const std::vector<qi::Future<qi::AnyValue> >& futures)
+{
+  boost::shared_ptr<WhenAny> any(new WhenAny());
+
+  if (futures.empty())
+  {
+    any->promise.setError("No future given");
+    return any->promise.future();
+  }
+
+  qi::Future<qi::AnyValue> ret = any->promise.future();
+  for (size_t i = 0; i < futures.size(); ++i)
+  {
+    qi::Future<qi::AnyValue> future = futures[i];
+    future.connect(boost::bind(&when_any_finished, _1, any, (int) i));
+  }
+  return ret;
+}
+
+jlong Java_com_aldebaran_qi_Future_qiFutureWhenAll(JNIEnv* env, jclass QI_UNUSED(cls), jlongArray pFutures)
+{
+  return java_future_handle(when_all_values(java_futures(env, pFutures)));
+}
+
+jlong Java_com_aldebaran_qi_Future_qiFutureWhenAny(JNIEnv* env, jclass QI_UNUSED(cls), jlongArray pFutures)
+{
+  return java_future_handle(when_any(java_futures(env, pFutures)));
+}
+
+jboolean Java_com_aldebaran_qi_Future_qiFutureWaitAll(JNIEnv* env, jclass QI_UNUSED(cls), jlongArray pFutures, jint timeout)
+{
+  qi::Future<std::vector<qi::Future<qi::AnyValue> > > all = when_all(java_futures(env, pFutures));
+
+  if (timeout)
+    return all.wait(timeout) != qi::FutureState_Running;
+  all.wait();
   return true;
 }
 
-void  Java_com_aldebaran_qi_Future_qiFutureCallWaitWithTimeout(JNIEnv* QI_UNUSED(env), jobject QI_UNUSED(obj), jlong pFuture, jint timeout)
+jint Java_com_aldebaran_qi_Future_qiFutureWaitAny(JNIEnv* env, jclass QI_UNUSED(cls), jlongArray pFutures, jint timeout)
+{
+  qi::Future<qi::AnyValue> any = when_any(java_futures(env, pFutures));
+
+  qi::FutureState state = timeout ? any.wait(timeout) : any.wait();
+  if (state != qi::FutureState_FinishedWithValue)
+    return -1;
+  return any.value().to<int>();
+}
+
+void  Java_com_aldebaran_qi_Future_qiFutureCallWaitWithTimeout(JNIEnv* env, jobject QI_UNUSED(obj), jlong pFuture, jint timeout)
 {
-  qi::Future<qi::AnyValue>* fut = reinterpret_cast<qi::Future<qi::AnyValue>*>(pFuture);
+  qi::Future<qi::AnyValue> fut;
+  if (!future_of_handle(env, pFuture, fut))
+    return;
 
   if (timeout)
-    fut->wait(timeout);
+    fut.wait(timeout);
   else
-    fut->wait();
+    fut.wait();
 }
 
 void  Java_com_aldebaran_qi_Future_qiFutureDestroy(JNIEnv* QI_UNUSED(env), jobject QI_UNUSED(obj), jlong pFuture)
 {
-  qi::Future<qi::AnyValue>* fut = reinterpret_cast<qi::Future<qi::AnyValue>*>(pFuture);
-  delete fut;
+  // Closed futures are released again when collected: stale handles are ignored.
+  gFutureHandles.remove(pFuture);
+}
+
+jboolean Java_com_aldebaran_qi_Future_qiFutureIsValid(JNIEnv* QI_UNUSED(env), jclass QI_UNUSED(cls), jlong pFuture)
+{
+  qi::Future<qi::AnyValue> fut;
+
+  return gFutureHandles.get(pFuture, fut);
 }
@@ -7,126 +7,88 @@
 ** See COPYING for the license
 */
 
+#include <boost/thread/mutex.hpp>
+
 #include <futurehandler.hpp>
+#include <future_jni.hpp>
 
 /**
- * @brief globalFutureHandler
- * Foreach callback set in Java, an entry is added here.
- * QiMessaging bindings search here when callback from future is called to find out which Java callback
- * needs to be called.
+ * com.aldebaran.qi.Future class and constructor, resolved once.
+ * Each callback is bound to its future continuation: there is no global
+ * registry to search when a future finishes.
  */
-static qi::FutureHandler globalFutureHandler;
+static jclass      gFutureClass = 0;
+static jmethodID   gFutureInit = 0;
+static boost::mutex gFutureClassMutex;
 
 namespace qi {
 
-  void FutureHandler::onSuccess(JNIEnv *env, jclass cls, qi::CallbackInfo *info)
+  void FutureHandler::init(JNIEnv* env)
   {
-    jmethodID mid = env->GetMethodID(cls, "onSuccess", "(Lcom/aldebaran/qi/Future;[Ljava/lang/Object;)V");
-    if (mid == 0)
-    {
-      qiLogError("qimessaging.jni") << "onSuccess method of com.aldebaran.qi.Callback is not implemented";
-      return;
-    }
+    boost::mutex::scoped_lock lock(gFutureClassMutex);
 
-    jobject fut = FutureHandler::futurePointer(env, info);
-    env->CallObjectMethod(info->instance, mid, fut, info->args);
-    env->DeleteGlobalRef(fut);
-  }
+    if (gFutureClass)
+      return;
 
-  void FutureHandler::onFailure(JNIEnv *env, jclass cls, qi::CallbackInfo *info)
-  {
-    jmethodID mid = env->GetMethodID(cls, "onFailure", "(Lcom/aldebaran/qi/Future;[Ljava/lang/Object;)V");
-    if (mid == 0)
+    jclass cls = env->FindClass(QI_FUTURE_CLASS);
+    if (!cls)
     {
-      qiLogError("qimessaging.jni") << "onFailure method of com.aldebaran.qi.Callback is not implemented";
+      env->ExceptionClear();
+      qiLogError("qimessaging.jni") << "Cannot find com.aldebaran.qi.Future class";
       return;
     }
 
-    jobject fut = FutureHandler::futurePointer(env, info);
-    env->CallObjectMethod(info->instance, mid, fut, info->args);
-    env->DeleteGlobalRef(fut);
+    gFutureInit = env->GetMethodID(cls, "<init>", "(J)V");
+    if (!gFutureInit)
+    {
+      env->ExceptionClear();
+      qiLogError("qimessaging.jni") << "Cannot find com.aldebaran.qi.Future.<init>(J) constructor";
+    }
+    gFutureClass = (jclass) env->NewGlobalRef(cls);
+    env->DeleteLocalRef(cls);
   }
 
-  void FutureHandler::onComplete(JNIEnv *env, jclass cls, qi::CallbackInfo *info)
+  void FutureHandler::call(JNIEnv *env, jmethodID method, const char* name, const qi::Future<qi::AnyValue>& future, qi::CallbackInfo *info)
   {
-    jmethodID mid = env->GetMethodID(cls, "onComplete", "(Lcom/aldebaran/qi/Future;[Ljava/lang/Object;)V");
-    if (mid == 0)
+    if (method == 0)
     {
-      qiLogError("qimessaging.jni") << "onComplete method of com.aldebaran.qi.Callback is not implemented";
+      qiLogError("qimessaging.jni") << name << " method of com.aldebaran.qi.Callback is not implemented";
       return;
     }
 
-    jobject fut = FutureHandler::futurePointer(env, info);
-    env->CallObjectMethod(info->instance, mid, fut, info->args);
-    env->DeleteGlobalRef(fut);
+    jobject fut = FutureHandler::futurePointer(env, future);
+    env->CallVoidMethod(info->instance, method, fut, info->args);
+    if (env->ExceptionCheck())
+      qiLogError("qimessaging.jni") << info->className << "." << name << ": " << qi::jni::javaExceptionMessage(env);
+    env->DeleteLocalRef(fut);
   }
 
-  qi::CallbackInfo* FutureHandler::methodInfo(const qi::Future<qi::AnyValue> &future)
+  void FutureHandler::onSuccess(JNIEnv *env, const qi::Future<qi::AnyValue>& future, qi::CallbackInfo *info)
   {
-    for (std::map<qi::Future<qi::AnyValue>*, qi::CallbackInfo*>::iterator it = globalFutureHandler._map.begin();
-         it != globalFutureHandler._map.end(); ++it)
-    {
-      qi::Future<qi::AnyValue> *iterator = (*it).first;
-
-      if (*iterator == future)
-        return (*it).second;
-    }
-
-    return 0;
+    call(env, info->onSuccess, "onSuccess", future, info);
   }
 
-  void FutureHandler::addCallbackInfo(qi::Future<AnyValue> *future, qi::CallbackInfo* info)
+  void FutureHandler::onFailure(JNIEnv *env, const qi::Future<qi::AnyValue>& future, qi::CallbackInfo *info)
   {
-    globalFutureHandler._map[future] = info;
+    call(env, info->onFailure, "onFailure", future, info);
   }
 
-  void FutureHandler::removeCallbackInfo(const qi::Future<qi::AnyValue>& future)
+  void FutureHandler::onComplete(JNIEnv *env, const qi::Future<qi::AnyValue>& future, qi::CallbackInfo *info)
   {
-    for (std::map<qi::Future<qi::AnyValue>*, qi::CallbackInfo*>::iterator it = globalFutureHandler._map.begin();
-         it != globalFutureHandler._map.end(); ++it)
-    {
-      qi::Future<qi::AnyValue> *iterator = (*it).first;
-
-      if (*iterator == future)
-      {
-        delete (*it).second;
-        globalFutureHandler._map.erase(it);
-        return;
-      }
-    }
+    call(env, info->onComplete, "onComplete", future, info);
   }
 
-  jobject FutureHandler::futurePointer(JNIEnv *env, qi::CallbackInfo* info)
+  jobject FutureHandler::futurePointer(JNIEnv *env, const qi::Future<qi::AnyValue>& future)
   {
-    for (std::map<qi::Future<qi::AnyValue>*, qi::CallbackInfo*>::iterator it = globalFutureHandler._map.begin();
-         it != globalFutureHandler._map.end(); ++it)
-    {
-      if ((*it).second == info)
-      {
-        jclass futureCls = 0;
-        jmethodID init = 0;
-
-        if ((futureCls = env->FindClass("com/aldebaran/qi/Future")) == 0)
-        {
-          qiLogError("qimessaging.jni") << "Cannot find com.aldebaran.qi.Future class";
-          return 0;
-        }
-
-        if ((init = env->GetMethodID(futureCls, "<init>", "(J)V")) == 0)
-        {
-          qiLogError("qimessaging.jni") << "Cannot find com.aldebaran.qi.Future.<init>(J) constructor";
-          return 0;
-        }
-
-        // Create a new Future class.
-        // Add a new global ref to object to avoid destruction before entry into Java code.
-        jobject future = env->NewObject(futureCls, init, (*it).first);
-        env->NewGlobalRef(future);
-        return future;
-      }
-    }
-
-    return 0;
+    if (!gFutureClass || !gFutureInit)
+      return 0;
+
+    // The Java Future owns the handle of its C++ future, and releases it when closed or collected.
+    jlong handle = java_future_handle(future);
+    jobject ret = env->NewObject(gFutureClass, gFutureInit, handle);
+    if (!ret)
+      Java_com_aldebaran_qi_Future_qiFutureDestroy(env, 0, handle);
+    return ret;
   }
 
 } // !qi
@@ -0,0 +1,120 @@
+/*
+**
+** Copyright (C) 2015 Aldebaran Robotics
+** See COPYING for the license
+*/
+
+#include <qi/log.hpp>
+
+#include <jnitools.hpp>
+#include <javaexecutor.hpp>
+
+qiLogCategory("qimessaging.jni");
+
+namespace qi {
+
+  JavaExecutor::JavaExecutor(unsigned int threadCount, unsigned int maxQueueSize, unsigned int laneCount)
+    : _lanes(laneCount ? laneCount : 1)
+    , _queued(0)
+    , _maxQueueSize(maxQueueSize)
+    , _stopping(false)
+  {
+    for (unsigned int i = 0; i < threadCount; ++i)
+      _threads.push_back(new boost::thread(boost::bind(&JavaExecutor::run, this)));
+  }
+
+  JavaExecutor::~JavaExecutor()
+  {
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+      _stopping = true;
+    }
+    _cond.notify_all();
+
+    // Executor is owned by service informations, never by its own tasks:
+    // joining is safe. Threads run queued tasks before leaving, so no task
+    // outlives the executor.
+    for (std::vector<boost::thread*>::iterator it = _threads.begin(); it != _threads.end(); ++it)
+    {
+      (*it)->join();
+      delete *it;
+    }
+  }
+
+  bool JavaExecutor::post(const boost::function<void ()>& task, unsigned int lane)
+  {
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+      if (lane >= _lanes.size())
+        lane = _lanes.size() - 1;
+      TaskQueue& tasks = _lanes[lane];
+      if (_stopping || (_maxQueueSize && tasks.size() >= _maxQueueSize))
+        return false;
+      tasks.push_back(task);
+      ++_queued;
+    }
+    _cond.notify_one();
+    return true;
+  }
+
+  unsigned int JavaExecutor::queueSize()
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    return _queued;
+  }
+
+  unsigned int JavaExecutor::laneQueueSize(unsigned int lane)
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    if (lane >= _lanes.size())
+      return 0;
+    return _lanes[lane].size();
+  }
+
+  unsigned int JavaExecutor::laneCount() const
+  {
+    return _lanes.size();
+  }
+
+  void JavaExecutor::run()
+  {
+    // Attach once, every JNIAttach made by tasks reuses this one.
+    qi::jni::JNIAttach attach;
+    JNIEnv* env = attach.get();
+
+    while (true)
+    {
+      boost::function<void ()> task;
+      {
+        boost::mutex::scoped_lock lock(_mutex);
+        while (_queued == 0 && !_stopping)
+          _cond.wait(lock);
+        if (_queued == 0)
+          return; // Stopping, and queue is drained
+        std::vector<TaskQueue>::iterator lane = _lanes.begin();
+        while (lane->empty())
+          ++lane;
+        task = lane->front();
+        lane->pop_front();
+        --_queued;
+      }
+
+      // Local references a task leaves behind are freed with its frame:
+      // the thread is never detached, they would pile up otherwise.
+      bool framed = env->PushLocalFrame(16) == 0;
+      if (!framed)
+        env->ExceptionClear(); // OutOfMemoryError, run the task without a frame
+      try
+      {
+        task();
+      }
+      catch (std::exception& e)
+      {
+        qiLogError() << "Executor task failed: " << e.what();
+      }
+      if (framed)
+        env->PopLocalFrame(0);
+    }
+  }
+
+} // !qi
@@ -15,11 +15,44 @@
 #include "jnitools.hpp"
 
 #include <boost/thread/tss.hpp>
+#include <cstring>
 
 qiLogCategory("qimessaging.jni");
 
 std::map<std::string, jobject> supportedTypes;
 
+// Exception classes, resolved once in a Java thread: FindClass cannot find
+// them from native threads on android, and is slow on error paths.
+static jclass    gExceptionClass = 0;
+static jclass    gCallErrorClasses[4] = { 0, 0, 0, 0 };
+// (String) constructors of the classes above
+static jmethodID gExceptionInit = 0;
+static jmethodID gCallErrorInits[4] = { 0, 0, 0, 0 };
+static jmethodID gThrowableToString = 0;
+
+// Classes of the type system checked by qi::jni::qiSignature, most specific first.
+// Resolved once by initTypeSystem, as global references.
+struct TypeClass
+{
+  const char* name; // Key in supportedTypes
+  const char* signature;
+  jclass      cls;
+};
+static TypeClass gTypeClasses[] =
+{
+  { "Double", "d", 0 },
+  { "Tuple", "(m)", 0 },
+  { "List", "[m]", 0 },
+  { "Map", "{m}", 0 },
+  { "Object", "o", 0 },
+  { "Long", "l", 0 },
+  { "Boolean", "b", 0 },
+  { "Float", "f", 0 },
+  { "Integer", "i", 0 },
+  { "String", "s", 0 }
+};
+static const unsigned int gTypeClassCount = sizeof(gTypeClasses) / sizeof(gTypeClasses[0]);
+
 static void emergency()
 {
   qiLogFatal() << "Emergency, aborting";
@@ -64,6 +97,18 @@ void Java_com_aldebaran_qi_EmbeddedTools_initTypeSystem(JNIEnv* env, jobject QI_
     if (it->second == 0)
       qiLogFatal() << it->first << ": Initialization failed.";
   }
+
+  for (unsigned int i = 0; i < gTypeClassCount; ++i)
+  {
+    jobject instance = supportedTypes[gTypeClasses[i].name];
+    if (!instance || gTypeClasses[i].cls)
+      continue;
+    jclass cls = env->GetObjectClass(instance);
+    gTypeClasses[i].cls = (jclass) env->NewGlobalRef(cls);
+    env->DeleteLocalRef(cls);
+  }
+
+  qi::jni::initExceptions(env);
 }
 
 void Java_com_aldebaran_qi_EmbeddedTools_initTupleInTypeSystem(JNIEnv* env, jobject QI_UNUSED(jobj), jobject t1, jobject t2, jobject t3, jobject t4, jobject t5, jobject t6, jobject t7, jobject t8, jobject t9, jobject t10, jobject t11, jobject t12, jobject t13, jobject t14, jobject t15, jobject t16, jobject t17, jobject t18, jobject t19, jobject t20, jobject t21, jobject t22, jobject t23, jobject t24, jobject t25, jobject t26, jobject t27, jobject t28, jobject t29, jobject t30, jobject t31, jobject t32)
@@ -237,6 +282,9 @@ std::string   toJavaSignature(const std::string &signature)
  */
 jint throwJavaError(JNIEnv *env, const char *message)
 {
+  if (gExceptionClass)
+    return env->ThrowNew(gExceptionClass, message);
+
   jclass		 exClass;
   const char*    className = "java/lang/Exception" ;
 
@@ -247,9 +295,141 @@ jint throwJavaError(JNIEnv *env, const char *message)
     return 1;
   }
 
-  return env->ThrowNew(exClass, message);
+  jint ret = env->ThrowNew(exClass, message);
+  env->DeleteLocalRef(exClass);
+  return ret;
 }
 
+namespace qi {
+  namespace jni {
+
+    static jclass globalClass(JNIEnv* env, const char* name)
+    {
+      jclass cls = env->FindClass(name);
+      if (!cls)
+      {
+        env->ExceptionClear();
+        qiLogError() << "Cannot find exception class " << name;
+        return 0;
+      }
+
+      jclass ret = (jclass) env->NewGlobalRef(cls);
+      env->DeleteLocalRef(cls);
+      return ret;
+    }
+
+    static jmethodID messageConstructor(JNIEnv* env, jclass cls)
+    {
+      if (!cls)
+        return 0;
+
+      jmethodID init = env->GetMethodID(cls, "<init>", "(Ljava/lang/String;)V");
+      if (env->ExceptionCheck()) // NoSuchMethodError
+        env->ExceptionClear();
+      return init;
+    }
+
+    void initExceptions(JNIEnv* env)
+    {
+      if (gExceptionClass)
+        return;
+
+      gExceptionClass = globalClass(env, "java/lang/Exception");
+      gCallErrorClasses[CallError_Remote] = globalClass(env, QI_REMOTE_ERROR_CLASS);
+      gCallErrorClasses[CallError_Timeout] = globalClass(env, QI_TIMEOUT_ERROR_CLASS);
+      gCallErrorClasses[CallError_Cancelled] = globalClass(env, QI_CANCELLED_ERROR_CLASS);
+      gCallErrorClasses[CallError_Conversion] = globalClass(env, QI_CONVERSION_ERROR_CLASS);
+
+      gExceptionInit = messageConstructor(env, gExceptionClass);
+      for (unsigned int i = 0; i < sizeof(gCallErrorClasses) / sizeof(gCallErrorClasses[0]); ++i)
+        gCallErrorInits[i] = messageConstructor(env, gCallErrorClasses[i]);
+
+      jclass throwable = env->FindClass("java/lang/Throwable");
+      gThrowableToString = env->GetMethodID(throwable, "toString", "()Ljava/lang/String;");
+      env->DeleteLocalRef(throwable);
+    }
+
+    /// Start of the conversion errors raised by this bridge.
+    static const char* const gConversionErrors[] = {
+      "cannot convert parameters from ", // call_java_method
+      "Cannot serialize return value: Unable to convert JObject in AnyValue", // AnyValue_from_JObject
+      "Cannot convert GenericObject to Jobject.", // JObject_from_AnyValue
+      0
+    };
+
+    /**
+     * @brief callErrorKind Guess kind of a call error from its message.
+     * qimessaging errors are plain strings: known messages of this bridge
+     * are recognized, others are remote errors. A Java exception message
+     * carried in a remote error never starts with these messages.
+     */
+    CallErrorKind callErrorKind(const std::string& error)
+    {
+      if (error == "Call timed out" || error == "Call deadline exceeded")
+        return CallError_Timeout;
+      for (const char* const* it = gConversionErrors; *it; ++it)
+      {
+        if (error.compare(0, strlen(*it), *it) == 0)
+          return CallError_Conversion;
+      }
+      return CallError_Remote;
+    }
+
+    jint throwCallError(JNIEnv* env, const std::string& error, CallErrorKind kind)
+    {
+      if (!gCallErrorClasses[kind])
+        return throwJavaError(env, error.c_str());
+      return env->ThrowNew(gCallErrorClasses[kind], error.c_str());
+    }
+
+    jthrowable newCallError(JNIEnv* env, const std::string& error, CallErrorKind kind)
+    {
+      jclass cls = gExceptionClass;
+      jmethodID init = gExceptionInit;
+      if (gCallErrorInits[kind])
+      {
+        cls = gCallErrorClasses[kind];
+        init = gCallErrorInits[kind];
+      }
+      if (!init)
+        return 0;
+
+      jstring message = toJstring(error);
+      jthrowable ret = (jthrowable) env->NewObject(cls, init, message);
+      env->DeleteLocalRef(message);
+      return ret;
+    }
+
+    std::string javaExceptionMessage(JNIEnv* env)
+    {
+      std::string message = "Remote method thrown exception";
+      jthrowable exception = env->ExceptionOccurred();
+
+      env->ExceptionClear();
+      if (!exception)
+        return message;
+
+      // Class and message only: printing the stack trace on each error floods logs.
+      if (gThrowableToString)
+      {
+        jstring description = (jstring) env->CallObjectMethod(exception, gThrowableToString);
+        if (env->ExceptionCheck())
+          env->ExceptionClear();
+        else if (description)
+        {
+          message += ": " + toString(description);
+          releaseString(description);
+        }
+      }
+      env->DeleteLocalRef(exception);
+
+      qiLogVerbose() << message;
+      return message;
+    }
+
+  }// !jni
+}// !qi
+
 /**
  * @brief propertyBaseSignature Get the qitype signature of a Java class template (jclass)
  * @param env JNI environment
@@ -522,6 +702,21 @@ namespace qi {
       env->DeleteLocalRef(obj);
     }
 
+    // Get the qitype signature of a Java object, empty if its class is not
+    // part of the type system.
+    std::string qiSignature(JNIEnv* env, jobject object)
+    {
+      if (!env || !object)
+        return std::string();
+
+      for (unsigned int i = 0; i < gTypeClassCount; ++i)
+      {
+        if (gTypeClasses[i].cls && env->IsInstanceOf(object, gTypeClasses[i].cls))
+          return gTypeClasses[i].signature;
+      }
+      return std::string();
+    }
+
     // Return true is jobject is a QiMessaging tuple.
     bool        isTuple(jobject object)
     {
@@ -9,6 +9,7 @@
 
 
 #include <boost/locale.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include <qi/log.hpp>
 #include <qi/signature.hpp>
@@ -457,6 +458,17 @@ std::pair<qi::AnyReference, bool> AnyValue_from_JObject(jobject val)
   return std::make_pair(res, copy);
 }
 
+qi::AnyValue AnyValue_native_copy(const qi::AnyReference& value)
+{
+  if (value.type() != qi::typeOf<jobject>())
+    return qi::AnyValue(value, true, true);
+
+  std::pair<qi::AnyReference, bool> conv = AnyValue_from_JObject(*(jobject*)value.rawValue());
+  return qi::AnyValue(conv.first, !conv.second, true);
+}
+
+// Guards the pool of converted values of JObjectTypeInterface::get, called from any thread.
+static boost::mutex gReferencePoolMutex;
 
 /*
  * Define this struct to add jobject to the type system.
@@ -504,6 +516,10 @@ class JObjectTypeInterface: public qi::DynamicTypeInterface
       static unsigned int MEMORY_SIZE = 200;
       static bool init = false;
       static qi::AnyReference* memoryBuffer;
+      static unsigned int memoryPosition = 0;
+      std::pair<qi::AnyReference, bool> convValue = AnyValue_from_JObject(*((jobject*)ptrFromStorage(&storage)));
+
+      boost::mutex::scoped_lock lock(gReferencePoolMutex);
       if (!init)
       {
         /* This is such an awful hack, we'd rather provide a way to
@@ -516,8 +532,6 @@ class JObjectTypeInterface: public qi::DynamicTypeInterface
         if (MEMORY_SIZE)
           memoryBuffer = new qi::AnyReference[MEMORY_SIZE];
       }
-      static unsigned int memoryPosition = 0;
-      std::pair<qi::AnyReference, bool> convValue = AnyValue_from_JObject(*((jobject*)ptrFromStorage(&storage)));
       if (convValue.second && MEMORY_SIZE)
       {
         memoryBuffer[memoryPosition].destroy();
@@ -0,0 +1,85 @@
+/*
+**
+** Copyright (C) 2015 Aldebaran Robotics
+** See COPYING for the license
+*/
+
+#include <qi/jsoncodec.hpp>
+
+#include <memocache.hpp>
+
+namespace qi {
+
+  MemoCache::MemoCache(qi::MilliSeconds ttl, size_t maxEntries)
+    : _ttl(ttl)
+    , _maxEntries(maxEntries)
+  {
+  }
+
+  bool MemoCache::get(const std::string& key, qi::AnyValue& value)
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    boost::unordered_map<std::string, EntryList::iterator>::iterator it = _index.find(key);
+
+    if (it == _index.end())
+      return false;
+
+    if (qi::SteadyClock::now() >= it->second->expiry)
+    {
+      _entries.erase(it->second);
+      _index.erase(it);
+      return false;
+    }
+
+    _entries.splice(_entries.begin(), _entries, it->second);
+    value = it->second->value;
+    return true;
+  }
+
+  void MemoCache::put(const std::string& key, const qi::AnyValue& value)
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    boost::unordered_map<std::string, EntryList::iterator>::iterator it = _index.find(key);
+
+    if (it != _index.end())
+    {
+      _entries.erase(it->second);
+      _index.erase(it);
+    }
+
+    while (!_entries.empty() && _entries.size() >= _maxEntries)
+    {
+      _index.erase(_entries.back().key);
+      _entries.pop_back();
+    }
+
+    if (_maxEntries == 0)
+      return;
+
+    Entry entry;
+    entry.key = key;
+    entry.value = value;
+    entry.expiry = qi::SteadyClock::now() + _ttl;
+    _entries.push_front(entry);
+    _index[key] = _entries.begin();
+  }
+
+  size_t MemoCache::size()
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    return _entries.size();
+  }
+
+  std::string MemoCache::key(const qi::GenericFunctionParameters& params)
+  {
+    std::string key;
+
+    for (qi::GenericFunctionParameters::const_iterator it = params.begin(); it != params.end(); ++it)
+    {
+      key += qi::encodeJSON(*it);
+      key += '\0';
+    }
+    return key;
+  }
+
+} // !qi
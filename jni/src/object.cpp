@@ -7,17 +7,77 @@
 ** See COPYING for the license
 */
 
+#include <algorithm>
+#include <map>
 #include <qi/anyobject.hpp>
 #include <qi/jsoncodec.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include <jnitools.hpp>
 #include <object.hpp>
 #include <callbridge.hpp>
+#include <future_jni.hpp>
 #include <jobjectconverter.hpp>
+#include <proxypolicy.hpp>
 
 qiLogCategory("qimessaging.jni");
 
-extern MethodInfoHandler gInfoHandler;
+
+/**
+ * Shared signal subscriptions: Java listeners of the same signal of an object,
+ * on the same dispatcher lane, share one link. It is disconnected with its last listener.
+ * Subscriptions are keyed by the underlying object, so proxies to the same service share them.
+ * A subscription keeps its object: listeners receive events until disconnected, even once
+ * the proxy they were connected through is collected.
+ */
+typedef std::pair<std::pair<qi::GenericObject*, std::string>, int> FanoutKey;
+static std::map<FanoutKey, boost::shared_ptr<qi_signal_fanout> > gFanouts;
+
+struct FanoutListener
+{
+  FanoutKey                         key;
+  boost::shared_ptr<qi_method_info> info;
+};
+// Subscriber ids returned to Java
+static std::map<jlong, FanoutListener> gListeners;
+static jlong gNextListenerId = 1;
+static boost::mutex gFanoutsMutex;
+
+typedef std::pair<qi::AnyObject, qi::SignalLink> FanoutLink;
+
+/**
+ * @brief remove_listener Remove a listener from its shared subscription, gFanoutsMutex held.
+ * @return true if it was the last one, link is then set to the subscription to disconnect
+ */
+static bool remove_listener(std::map<jlong, FanoutListener>::iterator it, FanoutLink& link)
+{
+  FanoutKey key = it->second.key;
+  boost::shared_ptr<qi_method_info> info = it->second.info;
+  gListeners.erase(it);
+
+  std::map<FanoutKey, boost::shared_ptr<qi_signal_fanout> >::iterator fit = gFanouts.find(key);
+  boost::shared_ptr<qi_signal_fanout> fanout = fit->second;
+  {
+    boost::mutex::scoped_lock fanoutLock(fanout->mutex);
+    fanout->listeners.erase(std::find(fanout->listeners.begin(), fanout->listeners.end(), info));
+    if (!fanout->listeners.empty())
+      return false;
+  }
+  link = FanoutLink(fanout->object, fanout->link);
+  gFanouts.erase(fit);
+  return true;
+}
+
+static void disconnect_fanout_async(FanoutLink link)
+{
+  try
+  {
+    link.first.disconnect(link.second).async();
+  } catch (std::exception& e)
+  {
+    qiLogVerbose() << "Cannot disconnect signal: " << e.what();
+  }
+}
 
 static void adaptFuture(qi::Future<void> f, qi::Promise<qi::AnyValue> p)
 {
@@ -32,21 +92,20 @@ jlong   Java_com_aldebaran_qi_AnyObject_property(JNIEnv* env, jobject jobj, jlon
   qi::AnyObject&     obj = *(reinterpret_cast<qi::AnyObject*>(pObj));
   std::string        propName = qi::jni::toString(name);
 
-  qi::Future<qi::AnyValue>* ret = new qi::Future<qi::AnyValue>();
+  qi::Future<qi::AnyValue> ret;
 
   qi::jni::JNIAttach attach(env);
 
   try
   {
-    *ret = obj.property<qi::AnyValue>(propName);
+    ret = obj.property<qi::AnyValue>(propName);
   } catch (qi::FutureUserException& e)
   {
-    delete ret;
     throwJavaError(env, e.what());
     return 0;
   }
 
-  return (jlong) ret;
+  return java_future_handle(ret);
 }
 
 jlong  Java_com_aldebaran_qi_AnyObject_setProperty(JNIEnv* env, jobject QI_UNUSED(jobj), jlong pObj, jstring name, jobject property)
@@ -56,20 +115,24 @@ jlong  Java_com_aldebaran_qi_AnyObject_setProperty(JNIEnv* env, jobject QI_UNUSE
 
   qi::jni::JNIAttach attach(env);
 
-  qi::Future<qi::AnyValue>* ret = new qi::Future<qi::AnyValue>();
-
   qi::Future<void> f = obj.setProperty(propName, qi::AnyValue::from<jobject>(property)).async();
   qi::Promise<qi::AnyValue> promise;
-  *ret = promise.future();
   f.connect(adaptFuture, _1, promise);
-  return (jlong) ret;
+  return java_future_handle(promise.future());
 }
 
-jlong     Java_com_aldebaran_qi_AnyObject_asyncCall(JNIEnv* env, jobject QI_UNUSED(jobj), jlong pObject, jstring jmethod, jobjectArray args)
+/**
+ * @brief asyncCall Start a call from Java, through proxy settings if any.
+ * @param params Java objects or native values
+ * @param timeout Call fails if not finished in time, 0 for no timeout
+ * @return handle of the C++ future of the call, 0 if a Java exception has been thrown
+ */
+static jlong asyncCall(JNIEnv* env, jlong pObject, jstring jmethod, const qi::GenericFunctionParameters& params,
+                       qi::MilliSeconds timeout = qi::MilliSeconds(0))
 {
   qi::AnyObject&    obj = *(reinterpret_cast<qi::AnyObject*>(pObject));
   std::string       method;
-  qi::Future<qi::AnyValue>* fut = 0;
+  qi::Future<qi::AnyValue> fut;
 
   qi::jni::JNIAttach attach(env);
 
@@ -83,14 +146,119 @@ jlong     Java_com_aldebaran_qi_AnyObject_asyncCall(JNIEnv* env, jobject QI_UNUS
   // Get method name and parameters C style.
   method = qi::jni::toString(jmethod);
   try {
-    fut = call_from_java(env, obj, method, args);
+    boost::shared_ptr<qi::ProxyPolicy> policy = qi::ProxyPolicy::find(&obj);
+    if (policy)
+      fut = policy->call(env, obj, method, params);
+    else
+      fut = call_from_java(env, obj, method, params);
   } catch (std::exception& e)
   {
     throwJavaError(env, e.what());
     return 0;
   }
 
-  return (jlong) fut;
+  if (env->ExceptionCheck())
+    return 0;
+  if (timeout.count() > 0)
+    fut = call_with_deadline(fut, timeout);
+  return java_future_handle(fut);
+}
+
+jlong     Java_com_aldebaran_qi_AnyObject_asyncCall(JNIEnv* env, jobject QI_UNUSED(jobj), jlong pObject, jstring jmethod, jobjectArray args)
+{
+  qi::GenericFunctionParameters params;
+  std::vector<jobject> objs;
+
+  java_call_parameters(env, args, objs, params);
+  return asyncCall(env, pObject, jmethod, params);
+}
+
+jlong     Java_com_aldebaran_qi_AnyObject_asyncCallWithTimeout(JNIEnv* env, jobject QI_UNUSED(jobj), jlong pObject, jstring jmethod, jobjectArray args, jlong timeoutMs)
+{
+  qi::GenericFunctionParameters params;
+  std::vector<jobject> objs;
+
+  java_call_parameters(env, args, objs, params);
+  return asyncCall(env, pObject, jmethod, params, qi::MilliSeconds(timeoutMs));
+}
+
+/*
+ * Typed entry points: primitive parameters are given to qimessaging as is,
+ * without boxing them in Java objects.
+ */
+jlong     Java_com_aldebaran_qi_AnyObject_asyncCallI(JNIEnv* env, jobject QI_UNUSED(jobj), jlong pObject, jstring jmethod, jint a)
+{
+  int   ia = a;
+  qi::GenericFunctionParameters params;
+
+  params.push_back(qi::AnyReference::from(ia));
+  return asyncCall(env, pObject, jmethod, params);
+}
+
+jlong     Java_com_aldebaran_qi_AnyObject_asyncCallF(JNIEnv* env, jobject QI_UNUSED(jobj), jlong pObject, jstring jmethod, jfloat a)
+{
+  float fa = a;
+  qi::GenericFunctionParameters params;
+
+  params.push_back(qi::AnyReference::from(fa));
+  return asyncCall(env, pObject, jmethod, params);
+}
+
+jlong     Java_com_aldebaran_qi_AnyObject_asyncCallB(JNIEnv* env, jobject QI_UNUSED(jobj), jlong pObject, jstring jmethod, jboolean a)
+{
+  bool  ba = (a != JNI_FALSE);
+  qi::GenericFunctionParameters params;
+
+  params.push_back(qi::AnyReference::from(ba));
+  return asyncCall(env, pObject, jmethod, params);
+}
+
+jlong     Java_com_aldebaran_qi_AnyObject_asyncCallS(JNIEnv* env, jobject QI_UNUSED(jobj), jlong pObject, jstring jmethod, jstring a)
+{
+  if (!a)
+  {
+    throwJavaError(env, "String argument is null");
+    return 0;
+  }
+
+  std::string sa = qi::jni::toString(a);
+  qi::GenericFunctionParameters params;
+
+  params.push_back(qi::AnyReference::from(sa));
+  return asyncCall(env, pObject, jmethod, params);
+}
+
+jlong     Java_com_aldebaran_qi_AnyObject_asyncCallII(JNIEnv* env, jobject QI_UNUSED(jobj), jlong pObject, jstring jmethod, jint a, jint b)
+{
+  int   ia = a;
+  int   ib = b;
+  qi::GenericFunctionParameters params;
+
+  params.push_back(qi::AnyReference::from(ia));
+  params.push_back(qi::AnyReference::from(ib));
+  return asyncCall(env, pObject, jmethod, params);
+}
+
+jlong     Java_com_aldebaran_qi_AnyObject_asyncCallIF(JNIEnv* env, jobject QI_UNUSED(jobj), jlong pObject, jstring jmethod, jint a, jfloat b)
+{
+  int   ia = a;
+  float fb = b;
+  qi::GenericFunctionParameters params;
+
+  params.push_back(qi::AnyReference::from(ia));
+  params.push_back(qi::AnyReference::from(fb));
+  return asyncCall(env, pObject, jmethod, params);
+}
+
+jlong     Java_com_aldebaran_qi_AnyObject_asyncCallFF(JNIEnv* env, jobject QI_UNUSED(jobj), jlong pObject, jstring jmethod, jfloat a, jfloat b)
+{
+  float fa = a;
+  float fb = b;
+  qi::GenericFunctionParameters params;
+
+  params.push_back(qi::AnyReference::from(fa));
+  params.push_back(qi::AnyReference::from(fb));
+  return asyncCall(env, pObject, jmethod, params);
 }
 
 jstring   Java_com_aldebaran_qi_AnyObject_printMetaObject(JNIEnv* env, jobject QI_UNUSED(jobj), jlong pObject)
@@ -106,15 +274,81 @@ void      Java_com_aldebaran_qi_AnyObject_destroy(JNIEnv* QI_UNUSED(env), jobjec
 {
   qi::AnyObject*    obj = reinterpret_cast<qi::AnyObject*>(pObject);
 
+  qi::ProxyPolicy::remove(obj);
   delete obj;
 }
 
+void      Java_com_aldebaran_qi_AnyObject_setCallCollapsing(JNIEnv* env, jobject QI_UNUSED(jobj), jlong pObject, jstring jmethod, jboolean enabled)
+{
+  qi::AnyObject*    obj = reinterpret_cast<qi::AnyObject*>(pObject);
+
+  qi::ProxyPolicy::get(obj)->setCollapsed(qi::jni::toString(jmethod), enabled);
+}
 
-jlong     Java_com_aldebaran_qi_AnyObject_disconnect(JNIEnv *env, jobject jobj, jlong pObject, jlong subscriberId)
+void      Java_com_aldebaran_qi_AnyObject_setCallCache(JNIEnv* env, jobject QI_UNUSED(jobj), jlong pObject, jstring jmethod, jlong ttlMs, jlong maxBytes)
 {
-  qi::AnyObject&             obj = *(reinterpret_cast<qi::AnyObject *>(pObject));
+  qi::AnyObject*    obj = reinterpret_cast<qi::AnyObject*>(pObject);
+
+  if (ttlMs < 0 || maxBytes < 0)
+  {
+    throwJavaError(env, "Cache TTL and size must be positive.");
+    return;
+  }
+  qi::ProxyPolicy::get(obj)->setCache(qi::jni::toString(jmethod), qi::MilliSeconds(ttlMs), static_cast<size_t>(maxBytes));
+}
+
+void      Java_com_aldebaran_qi_AnyObject_setCallLimits(JNIEnv* env, jobject QI_UNUSED(jobj), jlong pObject, jint maxInFlight, jlong maxBytes, jint overflow)
+{
+  qi::AnyObject*    obj = reinterpret_cast<qi::AnyObject*>(pObject);
+
+  if (maxInFlight < 0 || maxBytes < 0)
+  {
+    throwJavaError(env, "Call limits must be positive.");
+    return;
+  }
+  qi::ProxyPolicy::get(obj)->limiter()->setLimits(maxInFlight, static_cast<size_t>(maxBytes), static_cast<qi::CallLimiter::Overflow>(overflow));
+}
+
+jlongArray Java_com_aldebaran_qi_AnyObject_callCounters(JNIEnv* env, jobject QI_UNUSED(jobj), jlong pObject)
+{
+  qi::AnyObject*    obj = reinterpret_cast<qi::AnyObject*>(pObject);
+  boost::shared_ptr<qi::ProxyPolicy> policy = qi::ProxyPolicy::find(obj);
+
+  return java_call_counters(env, policy ? policy->findLimiter() : boost::shared_ptr<qi::CallLimiter>());
+}
+
+void      Java_com_aldebaran_qi_AnyObject_setCacheInvalidationSignal(JNIEnv* env, jobject QI_UNUSED(jobj), jlong pObject, jstring jsignal)
+{
+  qi::AnyObject*    obj = reinterpret_cast<qi::AnyObject*>(pObject);
+  std::string       signal = jsignal ? qi::jni::toString(jsignal) : std::string();
+
+  try {
+    qi::ProxyPolicy::get(obj)->setInvalidationSignal(*obj, signal);
+  } catch (std::exception& e)
+  {
+    throwJavaError(env, e.what());
+  }
+}
+
+
+jlong     Java_com_aldebaran_qi_AnyObject_disconnect(JNIEnv *env, jobject jobj, jlong QI_UNUSED(pObject), jlong subscriberId)
+{
+  FanoutLink                 link;
+  {
+    boost::mutex::scoped_lock lock(gFanoutsMutex);
+    std::map<jlong, FanoutListener>::iterator it = gListeners.find(subscriberId);
+    if (it == gListeners.end())
+    {
+      throwJavaError(env, "Unknown subscriber id");
+      return 0;
+    }
+    if (!remove_listener(it, link))
+      return 0;
+  }
+
+  // Last listener: drop the subscription.
   try {
-    obj.disconnect(subscriberId);
+    link.first.disconnect(link.second);
   } catch (std::exception& e)
   {
     throwJavaError(env, e.what());
@@ -122,13 +356,71 @@ jlong     Java_com_aldebaran_qi_AnyObject_disconnect(JNIEnv *env, jobject jobj,
   return 0;
 }
 
+/**
+ * @brief add_listener Add a listener to a shared subscription, gFanoutsMutex held.
+ * @return subscriber id
+ */
+static jlong add_listener(const FanoutKey& key, boost::shared_ptr<qi_signal_fanout> fanout, boost::shared_ptr<qi_method_info> info)
+{
+  {
+    boost::mutex::scoped_lock fanoutLock(fanout->mutex);
+    fanout->listeners.push_back(info);
+  }
+  jlong id = gNextListenerId++;
+  FanoutListener& listener = gListeners[id];
+  listener.key = key;
+  listener.info = info;
+  return id;
+}
+
+/**
+ * @brief connect_listener Add a Java listener to the shared subscription of its signal, creating it if needed.
+ * The subscription is created out of lock: it is a network round-trip for a remote object.
+ * @return subscriber id, 0 if a Java exception has been thrown
+ */
+static jlong connect_listener(JNIEnv* env, qi::AnyObject* obj, const std::string& event, int lane, boost::shared_ptr<qi_method_info> info)
+{
+  FanoutKey key(std::make_pair(obj->asGenericObject(), event), lane);
+  {
+    boost::mutex::scoped_lock lock(gFanoutsMutex);
+    std::map<FanoutKey, boost::shared_ptr<qi_signal_fanout> >::iterator it = gFanouts.find(key);
+    if (it != gFanouts.end())
+      return add_listener(key, it->second, info);
+  }
+
+  boost::shared_ptr<qi_signal_fanout> fanout(new qi_signal_fanout());
+  fanout->lane = lane;
+  fanout->object = *obj;
+  try {
+    fanout->link = obj->connect(event,
+                                qi::SignalSubscriber(
+                                  qi::AnyFunction::fromDynamicFunction(
+                                    boost::bind(&event_fanout_to_java, boost::weak_ptr<qi_signal_fanout>(fanout), _1))).setCallType(qi::MetaCallType_Direct));
+  } catch (std::exception& e)
+  {
+    throwJavaError(env, e.what());
+    return 0;
+  }
+
+  jlong id;
+  {
+    boost::mutex::scoped_lock lock(gFanoutsMutex);
+    std::pair<std::map<FanoutKey, boost::shared_ptr<qi_signal_fanout> >::iterator, bool> inserted = gFanouts.insert(std::make_pair(key, fanout));
+    id = add_listener(key, inserted.first->second, info);
+    if (inserted.second)
+      return id;
+  }
+
+  // Another listener created the subscription meanwhile: join it and drop ours.
+  disconnect_fanout_async(FanoutLink(fanout->object, fanout->link));
+  return id;
+}
 
-jlong     Java_com_aldebaran_qi_AnyObject_connect(JNIEnv *env, jobject jobj, jlong pObject, jstring method, jobject instance, jstring service, jstring eventName)
+jlong     Java_com_aldebaran_qi_AnyObject_connect(JNIEnv *env, jobject jobj, jlong pObject, jstring method, jobject instance, jstring service, jstring eventName, jint lane)
 {
   qi::AnyObject&             obj = *(reinterpret_cast<qi::AnyObject *>(pObject));
   std::string                signature = qi::jni::toString(method);
   std::string                event = qi::jni::toString(eventName);
-  qi_method_info*            data;
   std::vector<std::string>  sigInfo;
 
   // Keep a pointer on JavaVM singleton if not already set.
@@ -144,23 +436,12 @@ jlong     Java_com_aldebaran_qi_AnyObject_connect(JNIEnv *env, jobject jobj, jlo
   signature.append("::");
   signature.append(sigInfo[2]);
 
-  // Create a struct holding a jobject instance, jmethodId id and other needed thing for callback
-  // Pass it to void * data to register_method
-  data = new qi_method_info(instance, signature, jobj);
-  gInfoHandler.push(data);
-
+  // Create a struct holding a jobject instance, jmethodId id and other needed thing for callback.
+  // Owned by the subscription, until the callback is disconnected and its last event delivered.
+  boost::shared_ptr<qi_method_info> data(new qi_method_info(instance, signature, jobj));
+  prepare_java_method(env, data.get());
 
-  try {
-    qi::SignalLink link =obj.connect(event,
-                        qi::SignalSubscriber(
-                          qi::AnyFunction::fromDynamicFunction(
-                            boost::bind(&event_callback_to_java, (void*) data, _1))).setCallType(qi::MetaCallType_Direct));
-    return link;
-  } catch (std::exception& e)
-  {
-    throwJavaError(env, e.what());
-    return 0;
-  }
+  return connect_listener(env, &obj, event, lane, data);
 }
 
 void      Java_com_aldebaran_qi_AnyObject_post(JNIEnv *env, jobject QI_UNUSED(jobj), jlong pObject, jstring eventName, jobjectArray jargs)
@@ -168,28 +449,24 @@ void      Java_com_aldebaran_qi_AnyObject_post(JNIEnv *env, jobject QI_UNUSED(jo
   qi::AnyObject obj = *(reinterpret_cast<qi::AnyObject *>(pObject));
   std::string   event = qi::jni::toString(eventName);
   qi::GenericFunctionParameters params;
-  std::string signature;
+  std::vector<jobject> objs;
   jsize size;
   jsize i = 0;
 
   qi::jni::JNIAttach attach(env);
 
+  // Arguments are given as jobject references: local Java subscribers receive
+  // them untouched, remote ones convert them when the event is serialized.
   size = env->GetArrayLength(jargs);
+  objs.resize(size);
   i = 0;
   while (i < size)
   {
-    jobject current = env->GetObjectArrayElement(jargs, i);
-    qi::AnyReference val = qi::AnyReference(AnyValue_from_JObject(current).first);
-    params.push_back(val);
+    objs[i] = env->GetObjectArrayElement(jargs, i);
+    params.push_back(qi::AnyReference::from(objs[i]));
     i++;
   }
 
-  // Signature construction
-  signature = event + "::(";
-  for (unsigned i=0; i< params.size(); ++i)
-    signature += params[i].signature(true).toString();
-  signature += ")";
-
   try {
     obj.metaPost(event, params);
   } catch (std::exception& e)
@@ -197,10 +474,9 @@ void      Java_com_aldebaran_qi_AnyObject_post(JNIEnv *env, jobject QI_UNUSED(jo
     throwJavaError(env, e.what());
   }
 
-  // Destroy arguments
-  i = 0;
-  for(qi::GenericFunctionParameters::iterator it = params.begin(); it != params.end(); ++it)
-    (*it).destroy();
+  // Release local references on arguments
+  for (i = 0; i < size; ++i)
+    env->DeleteLocalRef(objs[i]);
   return;
 }
 
@@ -19,6 +19,29 @@
 #include <callbridge.hpp>
 #include <objectbuilder.hpp>
 
+/**
+ * Settings of each DynamicObjectBuilder, shared with the methods it advertises.
+ * Entries are added on first use and removed when the builder is destroyed.
+ */
+static std::map<qi::DynamicObjectBuilder*, boost::shared_ptr<qi_service_info> > gServiceInfos;
+static boost::mutex gServiceInfosMutex;
+
+static boost::shared_ptr<qi_service_info> serviceInfo(qi::DynamicObjectBuilder* ob)
+{
+  boost::mutex::scoped_lock lock(gServiceInfosMutex);
+  boost::shared_ptr<qi_service_info>& info = gServiceInfos[ob];
+
+  if (!info)
+    info.reset(new qi_service_info());
+  return info;
+}
+
+static void removeServiceInfo(qi::DynamicObjectBuilder* ob)
+{
+  boost::mutex::scoped_lock lock(gServiceInfosMutex);
+  gServiceInfos.erase(ob);
+}
+
 jlong   Java_com_aldebaran_qi_GenericObject_qiObjectBuilderCreate(JNIEnv* env, jobject QI_UNUSED(jobj))
 {
   // Keep a pointer on JavaVM singleton if not already set.
@@ -66,10 +89,60 @@ jobject Java_com_aldebaran_qi_DynamicObjectBuilder_object(JNIEnv* env, jobject Q
 void    Java_com_aldebaran_qi_DynamicObjectBuilder_destroy(JNIEnv *env, jobject jobj, jlong pObjectBuilder)
 {
   qi::DynamicObjectBuilder *ob = reinterpret_cast<qi::DynamicObjectBuilder *>(pObjectBuilder);
+  removeServiceInfo(ob);
   delete ob;
 }
 
-jlong   Java_com_aldebaran_qi_DynamicObjectBuilder_advertiseMethod(JNIEnv *env, jobject jobj, jlong pObjectBuilder, jstring method, jobject instance, jstring className, jstring desc)
+/**
+ * @brief applyMethodOptions Read settings of a com.aldebaran.qi.MethodOptions into method infos.
+ * @return false if settings cannot be applied
+ */
+static bool applyMethodOptions(JNIEnv* env, jobject options, qi::DynamicObjectBuilder* ob, qi_method_info* data)
+{
+  if (!options)
+    return true;
+
+  jclass cls = env->GetObjectClass(options);
+  jlong memoizeTtl = env->GetLongField(options, env->GetFieldID(cls, "memoizeTtlMs", "J"));
+  jint memoizeMaxEntries = env->GetIntField(options, env->GetFieldID(cls, "memoizeMaxEntries", "I"));
+  jboolean cancellable = env->GetBooleanField(options, env->GetFieldID(cls, "cancellable", "Z"));
+  jint concurrency = env->GetIntField(options, env->GetFieldID(cls, "concurrency", "I"));
+  jint strandKey = env->GetIntField(options, env->GetFieldID(cls, "strandKey", "I"));
+  jlong deadline = env->GetLongField(options, env->GetFieldID(cls, "deadlineMs", "J"));
+  jstring batchHandler = (jstring) env->GetObjectField(options, env->GetFieldID(cls, "batchHandler", "Ljava/lang/String;"));
+  jint maxBatchSize = env->GetIntField(options, env->GetFieldID(cls, "maxBatchSize", "I"));
+  env->DeleteLocalRef(cls);
+
+  if (memoizeTtl > 0 && memoizeMaxEntries > 0)
+    data->memo.reset(new qi::MemoCache(qi::MilliSeconds(memoizeTtl), memoizeMaxEntries));
+  data->cancellable = (cancellable != JNI_FALSE);
+  data->deadline = qi::MilliSeconds(deadline > 0 ? deadline : 0);
+
+  if (concurrency != JavaConcurrency_Default)
+  {
+    // Methods of this object are no more serialized by qimessaging,
+    // callbridge queues each call according to its concurrency.
+    data->concurrency = concurrency;
+    data->strandKey = strandKey > 0 ? strandKey : 0;
+    data->service->nativeLocking = true;
+    ob->setThreadingModel(qi::ObjectThreadingModel_MultiThread);
+  }
+
+  if (batchHandler)
+  {
+    std::string handler = qi::jni::toString(batchHandler);
+    env->DeleteLocalRef(batchHandler);
+    if (!prepare_java_batch(env, data, handler, maxBatchSize > 0 ? maxBatchSize : 0))
+      return false;
+
+    // Batches are delivered asynchronously, callbridge orders them like other calls.
+    data->service->nativeLocking = true;
+    ob->setThreadingModel(qi::ObjectThreadingModel_MultiThread);
+  }
+  return true;
+}
+
+jlong   Java_com_aldebaran_qi_DynamicObjectBuilder_advertiseMethod(JNIEnv *env, jobject jobj, jlong pObjectBuilder, jstring method, jobject instance, jstring className, jstring desc, jobject options)
 {
   extern MethodInfoHandler   gInfoHandler;
   qi::DynamicObjectBuilder  *ob = reinterpret_cast<qi::DynamicObjectBuilder *>(pObjectBuilder);
@@ -86,8 +159,12 @@ jlong   Java_com_aldebaran_qi_DynamicObjectBuilder_advertiseMethod(JNIEnv *env,
   // Create a struct holding a jobject instance, jmethodId id and other needed thing for callback
   // Pass it to void * data to register_method
   // In java_callback, use it directly so we don't have to find method again
-  data = new qi_method_info(instance, signature, jobj);
+  data = new qi_method_info(instance, signature, jobj, serviceInfo(ob));
+  bool applied = applyMethodOptions(env, options, ob, data);
   gInfoHandler.push(data);
+  if (!applied)
+    return 0;
+  prepare_java_method(env, data);
 
   // Bind method signature on generic java callback
   sigInfo = qi::signatureSplit(signature);
@@ -123,6 +200,42 @@ jlong   Java_com_aldebaran_qi_DynamicObjectBuilder_advertiseProperty(JNIEnv *env
 jlong Java_com_aldebaran_qi_DynamicObjectBuilder_advertiseThreadSafeness(JNIEnv *env, jobject obj, jlong pObjectBuilder, jboolean isThreadSafe)
 {
   qi::DynamicObjectBuilder  *ob = reinterpret_cast<qi::DynamicObjectBuilder *>(pObjectBuilder);
-  ob->setThreadingModel(isThreadSafe?qi::ObjectThreadingModel_MultiThread:qi::ObjectThreadingModel_SingleThread);
+  boost::shared_ptr<qi_service_info> info = serviceInfo(ob);
+  info->threadSafe = isThreadSafe;
+  ob->setThreadingModel((isThreadSafe || info->nativeLocking) ? qi::ObjectThreadingModel_MultiThread : qi::ObjectThreadingModel_SingleThread);
+  return 1;
+}
+
+jlong Java_com_aldebaran_qi_DynamicObjectBuilder_setExecutor(JNIEnv *env, jobject obj, jlong pObjectBuilder, jint threadCount, jint maxQueueSize)
+{
+  qi::DynamicObjectBuilder  *ob = reinterpret_cast<qi::DynamicObjectBuilder *>(pObjectBuilder);
+  boost::shared_ptr<qi_service_info> info = serviceInfo(ob);
+
+  // Threads are attached to the JVM when they start.
+  JVM(env);
+  // Calls already queued on the replaced executor run before it is destroyed.
+  boost::shared_ptr<qi::JavaExecutor> executor;
+  if (threadCount > 0)
+    executor.reset(new qi::JavaExecutor(threadCount, maxQueueSize > 0 ? maxQueueSize : 0));
+  boost::atomic_store(&info->executor, executor);
+  return 1;
+}
+
+jlong Java_com_aldebaran_qi_DynamicObjectBuilder_setAdmissionLimits(JNIEnv *env, jobject obj, jlong pObjectBuilder, jint maxConcurrent, jint maxQueued, jlong maxQueueDelayMs)
+{
+  qi::DynamicObjectBuilder  *ob = reinterpret_cast<qi::DynamicObjectBuilder *>(pObjectBuilder);
+  boost::shared_ptr<qi_service_info> info = serviceInfo(ob);
+
+  if (maxConcurrent <= 0 && maxQueued <= 0 && maxQueueDelayMs <= 0)
+  {
+    info->admission.reset();
+    return 1;
+  }
+
+  if (!info->admission)
+    info->admission.reset(new qi::AdmissionControl());
+  info->admission->setLimits(maxConcurrent > 0 ? maxConcurrent : 0,
+                             maxQueued > 0 ? maxQueued : 0,
+                             qi::MilliSeconds(maxQueueDelayMs > 0 ? maxQueueDelayMs : 0));
   return 1;
 }
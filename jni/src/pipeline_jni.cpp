@@ -0,0 +1,282 @@
+/*
+**
+** Copyright (C) 2015 Aldebaran Robotics
+** See COPYING for the license
+*/
+
+#include <sstream>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <qi/log.hpp>
+#include <qi/future.hpp>
+
+#include <jnitools.hpp>
+#include <jobjectconverter.hpp>
+#include <callbridge.hpp>
+#include <future_jni.hpp>
+#include <pipeline_jni.hpp>
+
+qiLogCategory("qimessaging.jni");
+
+/**
+ * @brief The PipelineRun struct State of a running pipeline, shared by its continuations.
+ */
+struct PipelineRun
+{
+  std::vector<qi::CallPipeline::Step> steps;
+  std::vector<qi::AnyValue>           results;
+  qi::Promise<qi::AnyValue>           promise;
+  boost::mutex                        mutex;
+  qi::Future<qi::AnyValue>            current; // Future of running step
+  bool                                canceled; // Cancel requested, no more steps are started
+
+  PipelineRun()
+    : canceled(false)
+  {
+  }
+};
+
+static void run_step(boost::shared_ptr<PipelineRun> run, size_t index);
+
+static void step_done(boost::shared_ptr<PipelineRun> run, size_t index, qi::Future<qi::AnyValue> result)
+{
+  if (result.isCanceled())
+  {
+    run->promise.setCanceled();
+    return;
+  }
+  if (result.hasError())
+  {
+    std::stringstream ss;
+    ss << "Pipeline step " << index << " failed: " << result.error();
+    run->promise.setError(ss.str());
+    return;
+  }
+
+  if (index + 1 == run->steps.size())
+  {
+    run->promise.setValue(result.value());
+    return;
+  }
+  run->results[index] = result.value();
+  run_step(run, index + 1);
+}
+
+static void run_step(boost::shared_ptr<PipelineRun> run, size_t index)
+{
+  bool canceled;
+  {
+    boost::mutex::scoped_lock lock(run->mutex);
+    canceled = run->canceled;
+  }
+  // Cancel arrived while the previous step was finishing.
+  if (canceled)
+  {
+    run->promise.setCanceled();
+    return;
+  }
+
+  const qi::CallPipeline::Step& step = run->steps[index];
+  qi::Future<qi::AnyValue> fut;
+
+  try
+  {
+    qi::AnyObject object = step.target < 0 ? step.object : run->results[step.target].to<qi::AnyObject>();
+    if (!object)
+      throw std::runtime_error("target is not an object");
+
+    if (step.property)
+      fut = object.property<qi::AnyValue>(step.method);
+    else
+    {
+      // Earlier results are referenced as is, not copied.
+      qi::GenericFunctionParameters params;
+      for (size_t i = 0; i < step.args.size(); ++i)
+      {
+        if (step.refs[i] < 0)
+          params.push_back(step.args[i].asReference());
+        else
+          params.push_back(run->results[step.refs[i]].asReference());
+      }
+      fut = call_qi_method(object, step.method, params);
+    }
+  }
+  catch (std::exception& e)
+  {
+    std::stringstream ss;
+    ss << "Pipeline step " << index << " failed: " << e.what();
+    run->promise.setError(ss.str());
+    return;
+  }
+
+  {
+    boost::mutex::scoped_lock lock(run->mutex);
+    run->current = fut;
+    canceled = run->canceled;
+  }
+  fut.connect(&step_done, run, index, _1);
+
+  // Cancel arrived while this step was started.
+  if (canceled)
+  {
+    try
+    {
+      fut.cancel();
+    }
+    catch (std::exception&)
+    {
+    }
+  }
+}
+
+static void cancel_pipeline(boost::weak_ptr<PipelineRun> weakRun, qi::Promise<qi::AnyValue>& QI_UNUSED(promise))
+{
+  boost::shared_ptr<PipelineRun> run = weakRun.lock();
+  if (!run)
+    return;
+
+  qi::Future<qi::AnyValue> current;
+  {
+    boost::mutex::scoped_lock lock(run->mutex);
+    run->canceled = true;
+    current = run->current;
+  }
+  try
+  {
+    current.cancel();
+  }
+  catch (std::exception&)
+  {
+  }
+}
+
+namespace qi {
+
+  int CallPipeline::add(const Step& step)
+  {
+    _steps.push_back(step);
+    return _steps.size() - 1;
+  }
+
+  size_t CallPipeline::size() const
+  {
+    return _steps.size();
+  }
+
+  qi::Future<qi::AnyValue> CallPipeline::run() const
+  {
+    if (_steps.empty())
+      return qi::Future<qi::AnyValue>(qi::AnyValue(qi::typeOf<void>()));
+
+    boost::shared_ptr<PipelineRun> run(new PipelineRun());
+    run->steps = _steps;
+    run->results.resize(_steps.size());
+    // Cancel callback must not keep the run alive: the run owns the promise.
+    run->promise = qi::Promise<qi::AnyValue>(boost::bind(&cancel_pipeline, boost::weak_ptr<PipelineRun>(run), _1));
+
+    qi::Future<qi::AnyValue> ret = run->promise.future();
+    run_step(run, 0);
+    return ret;
+  }
+
+} // !qi
+
+/**
+ * @brief pipeline_target Fill target of a step, from a com.aldebaran.qi.AnyObject or an earlier step.
+ * @return false if a Java exception has been thrown
+ */
+static bool pipeline_target(JNIEnv* env, qi::CallPipeline* pipeline, jobject object, jint target, qi::CallPipeline::Step& step)
+{
+  step.target = -1;
+  if (object)
+  {
+    jclass cls = env->GetObjectClass(object);
+    jlong pObject = env->GetLongField(object, env->GetFieldID(cls, "_p", "J"));
+    env->DeleteLocalRef(cls);
+    step.object = *(reinterpret_cast<qi::AnyObject*>(pObject));
+    return true;
+  }
+
+  if (target < 0 || target >= (jint) pipeline->size())
+  {
+    throwJavaError(env, "Pipeline target must be an object or an earlier step");
+    return false;
+  }
+  step.target = target;
+  return true;
+}
+
+jlong Java_com_aldebaran_qi_Pipeline_create(JNIEnv* QI_UNUSED(env), jclass QI_UNUSED(cls))
+{
+  return (jlong) new qi::CallPipeline();
+}
+
+void  Java_com_aldebaran_qi_Pipeline_destroy(JNIEnv* QI_UNUSED(env), jclass QI_UNUSED(cls), jlong pPipeline)
+{
+  delete reinterpret_cast<qi::CallPipeline*>(pPipeline);
+}
+
+jint  Java_com_aldebaran_qi_Pipeline_addCall(JNIEnv* env, jclass QI_UNUSED(cls), jlong pPipeline, jobject object, jint target, jstring method, jobjectArray args)
+{
+  qi::CallPipeline* pipeline = reinterpret_cast<qi::CallPipeline*>(pPipeline);
+  qi::CallPipeline::Step step;
+
+  qi::jni::JNIAttach attach(env);
+  step.property = false;
+  step.method = qi::jni::toString(method);
+  if (!pipeline_target(env, pipeline, object, target, step))
+    return -1;
+
+  jclass resultClass = env->FindClass("com/aldebaran/qi/Pipeline$Result");
+  jfieldID stepField = env->GetFieldID(resultClass, "step", "I");
+  jsize size = env->GetArrayLength(args);
+  for (jsize i = 0; i < size; ++i)
+  {
+    jobject arg = env->GetObjectArrayElement(args, i);
+
+    if (arg && env->IsInstanceOf(arg, resultClass))
+    {
+      jint ref = env->GetIntField(arg, stepField);
+      qi::jni::releaseObject(arg);
+      if (ref < 0 || ref >= (jint) pipeline->size())
+      {
+        env->DeleteLocalRef(resultClass);
+        throwJavaError(env, "Pipeline argument must be the result of an earlier step");
+        return -1;
+      }
+      step.args.push_back(qi::AnyValue());
+      step.refs.push_back(ref);
+      continue;
+    }
+
+    // Steps run later, in other threads: arguments are converted now.
+    std::pair<qi::AnyReference, bool> conv = AnyValue_from_JObject(arg);
+    step.args.push_back(qi::AnyValue(conv.first, !conv.second, true));
+    step.refs.push_back(-1);
+    qi::jni::releaseObject(arg);
+  }
+  env->DeleteLocalRef(resultClass);
+
+  return pipeline->add(step);
+}
+
+jint  Java_com_aldebaran_qi_Pipeline_addProperty(JNIEnv* env, jclass QI_UNUSED(cls), jlong pPipeline, jobject object, jint target, jstring name)
+{
+  qi::CallPipeline* pipeline = reinterpret_cast<qi::CallPipeline*>(pPipeline);
+  qi::CallPipeline::Step step;
+
+  qi::jni::JNIAttach attach(env);
+  step.property = true;
+  step.method = qi::jni::toString(name);
+  if (!pipeline_target(env, pipeline, object, target, step))
+    return -1;
+  return pipeline->add(step);
+}
+
+jlong Java_com_aldebaran_qi_Pipeline_run(JNIEnv* QI_UNUSED(env), jclass QI_UNUSED(cls), jlong pPipeline)
+{
+  qi::CallPipeline* pipeline = reinterpret_cast<qi::CallPipeline*>(pPipeline);
+
+  return java_future_handle(pipeline->run());
+}
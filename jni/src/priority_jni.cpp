@@ -0,0 +1,36 @@
+/*
+**
+** Copyright (C) 2015 Aldebaran Robotics
+** See COPYING for the license
+*/
+
+#include <boost/thread/mutex.hpp>
+#include <qi/macro.hpp>
+
+#include <jnitools.hpp>
+#include <priority_jni.hpp>
+
+/// Threads of the dispatcher: a slow callback does not hold back the others.
+#define QI_DISPATCHER_THREADS 2
+
+static qi::JavaExecutor* gDispatcher = 0;
+static boost::mutex      gDispatcherMutex;
+
+qi::JavaExecutor* java_dispatcher()
+{
+  boost::mutex::scoped_lock lock(gDispatcherMutex);
+
+  // Never deleted: its threads are attached to the JVM until the process exits.
+  if (!gDispatcher)
+    gDispatcher = new qi::JavaExecutor(QI_DISPATCHER_THREADS, 0, QI_PRIORITY_LANES);
+  return gDispatcher;
+}
+
+jint Java_com_aldebaran_qi_Priority_queueDepth(JNIEnv* QI_UNUSED(env), jclass QI_UNUSED(cls), jint lane)
+{
+  boost::mutex::scoped_lock lock(gDispatcherMutex);
+
+  if (!gDispatcher || lane < 0)
+    return 0;
+  return gDispatcher->laneQueueSize(lane);
+}
@@ -0,0 +1,70 @@
+/*
+**
+** Copyright (C) 2015 Aldebaran Robotics
+** See COPYING for the license
+*/
+
+#include <qi/log.hpp>
+#include <qi/future.hpp>
+#include <qi/anyvalue.hpp>
+
+#include <jnitools.hpp>
+#include <promise_jni.hpp>
+#include <future_jni.hpp>
+
+qiLogCategory("qimessaging.jni");
+
+jlong Java_com_aldebaran_qi_Promise_qiPromiseCreate(JNIEnv* env, jclass QI_UNUSED(cls))
+{
+  // Future callbacks may be called from any thread, keep a pointer on the JVM.
+  JVM(env);
+
+  qi::Promise<qi::AnyValue>* promise = new qi::Promise<qi::AnyValue>();
+  return (jlong) promise;
+}
+
+void Java_com_aldebaran_qi_Promise_qiPromiseDestroy(JNIEnv* QI_UNUSED(env), jclass QI_UNUSED(cls), jlong pPromise)
+{
+  qi::Promise<qi::AnyValue>* promise = reinterpret_cast<qi::Promise<qi::AnyValue>*>(pPromise);
+  delete promise;
+}
+
+jlong Java_com_aldebaran_qi_Promise_qiPromiseGetFuture(JNIEnv* QI_UNUSED(env), jclass QI_UNUSED(cls), jlong pPromise)
+{
+  qi::Promise<qi::AnyValue>* promise = reinterpret_cast<qi::Promise<qi::AnyValue>*>(pPromise);
+  return java_future_handle(promise->future());
+}
+
+void Java_com_aldebaran_qi_Promise_qiPromiseSetValue(JNIEnv* env, jclass QI_UNUSED(cls), jlong pPromise, jobject value)
+{
+  qi::Promise<qi::AnyValue>* promise = reinterpret_cast<qi::Promise<qi::AnyValue>*>(pPromise);
+
+  qi::jni::JNIAttach attach(env);
+
+  try
+  {
+    // Keep the Java object as is, it is converted only if the value leaves the JVM.
+    if (value)
+      promise->setValue(qi::AnyValue::from<jobject>(value));
+    else
+      promise->setValue(qi::AnyValue(qi::typeOf<void>()));
+  }
+  catch (std::exception& e)
+  {
+    throwJavaError(env, e.what());
+  }
+}
+
+void Java_com_aldebaran_qi_Promise_qiPromiseSetError(JNIEnv* env, jclass QI_UNUSED(cls), jlong pPromise, jstring error)
+{
+  qi::Promise<qi::AnyValue>* promise = reinterpret_cast<qi::Promise<qi::AnyValue>*>(pPromise);
+
+  try
+  {
+    promise->setError(qi::jni::toString(error));
+  }
+  catch (std::exception& e)
+  {
+    throwJavaError(env, e.what());
+  }
+}
@@ -0,0 +1,436 @@
+/*
+**
+** Copyright (C) 2015 Aldebaran Robotics
+** See COPYING for the license
+*/
+
+#include <qi/log.hpp>
+#include <qi/jsoncodec.hpp>
+#include <qi/anyfunction.hpp>
+
+#include <jnitools.hpp>
+#include <callbridge.hpp>
+#include <jobjectconverter.hpp>
+#include <proxypolicy.hpp>
+
+qiLogCategory("qimessaging.jni");
+
+/**
+ * @brief globalProxyPolicies
+ * Settings of each com.aldebaran.qi.AnyObject, keyed by its C++ object pointer.
+ */
+static std::map<qi::AnyObject*, boost::shared_ptr<qi::ProxyPolicy> > globalProxyPolicies;
+static boost::mutex globalProxyPoliciesMutex;
+
+static void forwardFuture(qi::Future<qi::AnyValue> f, qi::Promise<qi::AnyValue> p)
+{
+  // Promise of a limited call is already failed if the call was dropped.
+  if (!p.future().isRunning())
+    return;
+
+  try
+  {
+    if (f.isCanceled())
+      p.setCanceled();
+    else if (f.hasError())
+      p.setError(f.error());
+    else
+      p.setValue(f.value());
+  }
+  catch (std::exception&)
+  {
+    // Dropped concurrently.
+  }
+}
+
+static void finishLimitedCall(boost::shared_ptr<qi::CallLimiter> limiter, qi::uint64_t ticket)
+{
+  limiter->finish(ticket);
+}
+
+/**
+ * @brief The LimitedCall struct Call made once admitted by limiters, set after its promise is created.
+ */
+struct LimitedCall
+{
+  boost::mutex             mutex;
+  boost::function<void ()> cancel; // Canceler of the call, holds no reference on it
+  bool                     started;
+  bool                     cancelRequested;
+
+  LimitedCall()
+    : started(false)
+    , cancelRequested(false)
+  {
+  }
+};
+
+/**
+ * @brief stopLimitedCall Cancel the call, now or as soon as it is started.
+ */
+static void stopLimitedCall(boost::shared_ptr<LimitedCall> limited)
+{
+  boost::function<void ()> cancel;
+  bool started;
+  {
+    boost::mutex::scoped_lock lock(limited->mutex);
+    limited->cancelRequested = true;
+    cancel = limited->cancel;
+    started = limited->started;
+  }
+
+  if (!started)
+    return;
+  try
+  {
+    cancel();
+  }
+  catch (std::exception&)
+  {
+    // Not cancelable
+  }
+}
+
+static void cancelLimitedCall(boost::shared_ptr<LimitedCall> limited, qi::Promise<qi::AnyValue>& QI_UNUSED(promise))
+{
+  stopLimitedCall(limited);
+}
+
+namespace qi {
+
+  ProxyPolicy::MethodPolicy::MethodPolicy()
+    : collapsed(false)
+    , ttl(0)
+    , maxBytes(0)
+    , bytes(0)
+  {
+  }
+
+  ProxyPolicy::ProxyPolicy()
+    : _cacheGeneration(0)
+    , _invalidationLink(qi::SignalBase::invalidSignalLink)
+  {
+  }
+
+  boost::shared_ptr<ProxyPolicy> ProxyPolicy::get(qi::AnyObject* object)
+  {
+    boost::mutex::scoped_lock lock(globalProxyPoliciesMutex);
+    boost::shared_ptr<ProxyPolicy>& policy = globalProxyPolicies[object];
+
+    if (!policy)
+    {
+      policy.reset(new ProxyPolicy());
+      policy->_self = policy;
+    }
+    return policy;
+  }
+
+  boost::shared_ptr<ProxyPolicy> ProxyPolicy::find(qi::AnyObject* object)
+  {
+    boost::mutex::scoped_lock lock(globalProxyPoliciesMutex);
+
+    if (globalProxyPolicies.empty())
+      return boost::shared_ptr<ProxyPolicy>();
+
+    std::map<qi::AnyObject*, boost::shared_ptr<ProxyPolicy> >::iterator it = globalProxyPolicies.find(object);
+    if (it == globalProxyPolicies.end())
+      return boost::shared_ptr<ProxyPolicy>();
+    return it->second;
+  }
+
+  void ProxyPolicy::remove(qi::AnyObject* object)
+  {
+    boost::shared_ptr<ProxyPolicy> policy;
+    {
+      boost::mutex::scoped_lock lock(globalProxyPoliciesMutex);
+      std::map<qi::AnyObject*, boost::shared_ptr<ProxyPolicy> >::iterator it = globalProxyPolicies.find(object);
+      if (it == globalProxyPolicies.end())
+        return;
+      policy = it->second;
+      globalProxyPolicies.erase(it);
+    }
+    policy->setInvalidationSignal(*object, std::string());
+  }
+
+  boost::shared_ptr<CallLimiter> ProxyPolicy::limiter()
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+
+    if (!_limiter)
+      _limiter.reset(new CallLimiter());
+    return _limiter;
+  }
+
+  boost::shared_ptr<CallLimiter> ProxyPolicy::findLimiter()
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    return _limiter;
+  }
+
+  void ProxyPolicy::setSessionLimiter(boost::shared_ptr<CallLimiter> limiter)
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    _sessionLimiter = limiter;
+  }
+
+  qi::Future<qi::AnyValue> ProxyPolicy::limitedCall(JNIEnv* env, qi::AnyObject object, const std::string& method, const qi::GenericFunctionParameters& params,
+                                                     const std::string& key)
+  {
+    boost::shared_ptr<CallLimiter> limiters[2];
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+      limiters[0] = _limiter;
+      limiters[1] = _sessionLimiter;
+    }
+
+    if (!limiters[0] && !limiters[1])
+      return call_from_java(env, object, method, params);
+
+    // Size of a call: its encoded arguments. Only computed if a byte limit is set.
+    size_t bytes = 0;
+    if ((limiters[0] && limiters[0]->limitsBytes()) || (limiters[1] && limiters[1]->limitsBytes()))
+      bytes = key.empty() ? callKey(method, params).size() : key.size();
+
+    boost::shared_ptr<LimitedCall> limited(new LimitedCall());
+    qi::Promise<qi::AnyValue> promise(boost::bind(&cancelLimitedCall, limited, _1));
+    qi::uint64_t tickets[2] = { 0, 0 };
+    for (int i = 0; i < 2; ++i)
+    {
+      if (!limiters[i])
+        continue;
+
+      tickets[i] = limiters[i]->admit(bytes, promise, boost::bind(&stopLimitedCall, limited));
+      if (!tickets[i])
+      {
+        if (i == 1 && tickets[0])
+          limiters[0]->finish(tickets[0]);
+        promise.setError("Call rejected: too many calls in flight");
+        return promise.future();
+      }
+      promise.future().connect(boost::bind(&finishLimitedCall, limiters[i], tickets[i]));
+    }
+
+    qi::Future<qi::AnyValue> fut = call_from_java(env, object, method, params);
+    fut.connect(forwardFuture, _1, promise);
+
+    // Cancel may have been requested while the call was started.
+    bool cancelRequested;
+    {
+      boost::mutex::scoped_lock lock(limited->mutex);
+      limited->cancel = fut.makeCanceler();
+      limited->started = true;
+      cancelRequested = limited->cancelRequested;
+    }
+    if (cancelRequested && fut.isCancelable())
+      fut.cancel();
+
+    return promise.future();
+  }
+
+  std::string ProxyPolicy::methodName(const std::string& method)
+  {
+    return method.substr(0, method.find("::"));
+  }
+
+  void ProxyPolicy::setCollapsed(const std::string& method, bool collapsed)
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    _methods[methodName(method)].collapsed = collapsed;
+  }
+
+  void ProxyPolicy::setCache(const std::string& method, qi::MilliSeconds ttl, size_t maxBytes)
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    MethodPolicy& policy = _methods[methodName(method)];
+
+    policy.ttl = ttl;
+    policy.maxBytes = maxBytes;
+    policy.cache.clear();
+    policy.order.clear();
+    policy.bytes = 0;
+    ++_cacheGeneration;
+  }
+
+  void ProxyPolicy::setInvalidationSignal(qi::AnyObject object, const std::string& signal)
+  {
+    qi::SignalLink previous;
+    qi::AnyObject previousObject;
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+      previous = _invalidationLink;
+      previousObject = _invalidationObject;
+      _invalidationLink = qi::SignalBase::invalidSignalLink;
+      _invalidationObject = qi::AnyObject();
+    }
+
+    if (previous != qi::SignalBase::invalidSignalLink)
+      previousObject.disconnect(previous).async();
+
+    if (signal.empty())
+      return;
+
+    qi::SignalLink link = object.connect(signal,
+                                         qi::SignalSubscriber(
+                                           qi::AnyFunction::fromDynamicFunction(
+                                             boost::bind(&ProxyPolicy::invalidate, _self, _1))).setCallType(qi::MetaCallType_Direct));
+
+    boost::mutex::scoped_lock lock(_mutex);
+    _invalidationLink = link;
+    _invalidationObject = object;
+  }
+
+  void ProxyPolicy::clearCache()
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+
+    for (std::map<std::string, MethodPolicy>::iterator it = _methods.begin(); it != _methods.end(); ++it)
+    {
+      it->second.cache.clear();
+      it->second.order.clear();
+      it->second.bytes = 0;
+    }
+    ++_cacheGeneration;
+  }
+
+  qi::AnyReference ProxyPolicy::invalidate(boost::weak_ptr<ProxyPolicy> weakPolicy, const std::vector<qi::AnyReference>& QI_UNUSED(params))
+  {
+    boost::shared_ptr<ProxyPolicy> policy = weakPolicy.lock();
+
+    if (policy)
+      policy->clearCache();
+    return qi::AnyReference(qi::typeOf<void>());
+  }
+
+  std::string ProxyPolicy::callKey(const std::string& method, const qi::GenericFunctionParameters& params)
+  {
+    std::string key = methodName(method);
+
+    for (qi::GenericFunctionParameters::const_iterator it = params.begin(); it != params.end(); ++it)
+    {
+      key += '\0';
+      key += qi::encodeJSON(*it);
+    }
+    return key;
+  }
+
+  void ProxyPolicy::erase(MethodPolicy& policy, const std::string& key)
+  {
+    boost::unordered_map<std::string, CacheEntry>::iterator it = policy.cache.find(key);
+
+    if (it == policy.cache.end())
+      return;
+    policy.bytes -= it->second.bytes;
+    policy.order.erase(it->second.order);
+    policy.cache.erase(it);
+  }
+
+  void ProxyPolicy::store(MethodPolicy& policy, const std::string& key, const qi::AnyValue& value)
+  {
+    size_t bytes = key.size() + qi::encodeJSON(value).size();
+
+    erase(policy, key);
+    if (bytes > policy.maxBytes)
+      return;
+
+    // Evict oldest entries until the new one fits.
+    while (policy.bytes + bytes > policy.maxBytes && !policy.order.empty())
+      erase(policy, policy.order.front());
+
+    CacheEntry& entry = policy.cache[key];
+    entry.value = value;
+    entry.expiry = qi::SteadyClock::now() + policy.ttl;
+    entry.bytes = bytes;
+    entry.order = policy.order.insert(policy.order.end(), key);
+    policy.bytes += bytes;
+  }
+
+  qi::Future<qi::AnyValue> ProxyPolicy::call(JNIEnv* env, qi::AnyObject object, const std::string& method, const qi::GenericFunctionParameters& params)
+  {
+    std::string name = methodName(method);
+    bool collapsed;
+    bool cached;
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+      std::map<std::string, MethodPolicy>::iterator it = _methods.find(name);
+      collapsed = it != _methods.end() && it->second.collapsed;
+      cached = it != _methods.end() && it->second.ttl.count() > 0;
+    }
+
+    if (!collapsed && !cached)
+      return limitedCall(env, object, method, params);
+
+    std::string key = callKey(method, params);
+    qi::Promise<qi::AnyValue> promise;
+    qi::uint64_t generation;
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+      generation = _cacheGeneration;
+
+      if (cached)
+      {
+        MethodPolicy& policy = _methods[name];
+        boost::unordered_map<std::string, CacheEntry>::iterator it = policy.cache.find(key);
+
+        if (it != policy.cache.end())
+        {
+          if (qi::SteadyClock::now() < it->second.expiry)
+            return qi::Future<qi::AnyValue>(it->second.value);
+          erase(policy, key);
+        }
+      }
+
+      if (collapsed)
+      {
+        boost::unordered_map<std::string, qi::Future<qi::AnyValue> >::iterator it = _inflight.find(key);
+        if (it != _inflight.end())
+          return it->second;
+        _inflight[key] = promise.future();
+      }
+    }
+
+    qi::Future<qi::AnyValue> fut = limitedCall(env, object, method, params, key);
+    if (cached)
+      fut.connect(boost::bind(&ProxyPolicy::storeResult, _self, name, key, generation, _1));
+    if (!collapsed)
+      return fut;
+
+    // The promise has no cancel callback: canceling one of the collapsed
+    // callers must not cancel the call shared by the others.
+    // Entry is removed as soon as the call finishes, whatever its result.
+    promise.future().connect(boost::bind(&ProxyPolicy::endCall, _self, key));
+    fut.connect(forwardFuture, _1, promise);
+
+    return promise.future();
+  }
+
+  void ProxyPolicy::endCall(boost::weak_ptr<ProxyPolicy> weakPolicy, const std::string& key)
+  {
+    boost::shared_ptr<ProxyPolicy> policy = weakPolicy.lock();
+    if (!policy)
+      return;
+
+    boost::mutex::scoped_lock lock(policy->_mutex);
+    policy->_inflight.erase(key);
+  }
+
+  void ProxyPolicy::storeResult(boost::weak_ptr<ProxyPolicy> weakPolicy, const std::string& method, const std::string& key,
+                                qi::uint64_t generation, qi::Future<qi::AnyValue> result)
+  {
+    boost::shared_ptr<ProxyPolicy> policy = weakPolicy.lock();
+    if (!policy || result.hasError() || result.isCanceled())
+      return;
+
+    // A Java object result would be shared by all callers served from the cache:
+    // keep a native copy, converted out of lock.
+    qi::AnyValue value = AnyValue_native_copy(result.value().asReference());
+
+    boost::mutex::scoped_lock lock(policy->_mutex);
+    // Cache was cleared while the call was in flight: its result may be stale.
+    if (generation != policy->_cacheGeneration)
+      return;
+    MethodPolicy& methodPolicy = policy->_methods[method];
+    if (methodPolicy.ttl.count() > 0)
+      policy->store(methodPolicy, key, value);
+  }
+
+} // !qi
@@ -0,0 +1,44 @@
+/*
+**
+** Copyright (C) 2015 Aldebaran Robotics
+** See COPYING for the license
+*/
+
+#include <boost/thread/tss.hpp>
+#include <qi/macro.hpp>
+
+#include <qicontext_jni.hpp>
+
+static void noCleanup(qi::jni::CallContext*)
+{
+}
+
+/// Context of the Java method run by current thread, owned by its CallContextScope.
+static boost::thread_specific_ptr<qi::jni::CallContext> gCurrentContext(&noCleanup);
+
+namespace qi {
+  namespace jni {
+
+    CallContextScope::CallContextScope(boost::shared_ptr<CallContext> context)
+      : _context(context)
+      , _previous(gCurrentContext.get())
+    {
+      gCurrentContext.reset(context.get());
+    }
+
+    CallContextScope::~CallContextScope()
+    {
+      gCurrentContext.reset(_previous);
+    }
+
+  } // !jni
+} // !qi
+
+jboolean Java_com_aldebaran_qi_QiContext_cancelRequested(JNIEnv* QI_UNUSED(env), jclass QI_UNUSED(cls))
+{
+  qi::jni::CallContext* context = gCurrentContext.get();
+
+  if (!context)
+    return false;
+  return *context->cancelRequested != 0;
+}
@@ -19,9 +19,34 @@
 #include <session_jni.hpp>
 #include <object_jni.hpp>
 #include <callbridge.hpp>
+#include <future_jni.hpp>
+#include <calllimiter.hpp>
+#include <proxypolicy.hpp>
 
 qiLogCategory("qimessaging.jni");
 
+/**
+ * Call limits of each com.aldebaran.qi.Session, shared by the proxies it gives.
+ * Entries are added by setCallLimits and removed when the session is destroyed.
+ */
+static std::map<qi::Session*, boost::shared_ptr<qi::CallLimiter> > gSessionLimiters;
+static boost::mutex gSessionLimitersMutex;
+
+static boost::shared_ptr<qi::CallLimiter> sessionLimiter(qi::Session* session, bool create)
+{
+  boost::mutex::scoped_lock lock(gSessionLimitersMutex);
+  std::map<qi::Session*, boost::shared_ptr<qi::CallLimiter> >::iterator it = gSessionLimiters.find(session);
+
+  if (it != gSessionLimiters.end())
+    return it->second;
+  if (!create)
+    return boost::shared_ptr<qi::CallLimiter>();
+
+  boost::shared_ptr<qi::CallLimiter> limiter(new qi::CallLimiter());
+  gSessionLimiters[session] = limiter;
+  return limiter;
+}
+
 jlong Java_com_aldebaran_qi_Session_qiSessionCreate()
 {
   qi::Session *session = new qi::Session();
@@ -32,6 +57,11 @@ jlong Java_com_aldebaran_qi_Session_qiSessionCreate()
 void Java_com_aldebaran_qi_Session_qiSessionDestroy(JNIEnv* QI_UNUSED(env), jobject QI_UNUSED(obj), jlong pSession)
 {
   qi::Session *s = reinterpret_cast<qi::Session*>(pSession);
+
+  {
+    boost::mutex::scoped_lock lock(gSessionLimitersMutex);
+    gSessionLimiters.erase(s);
+  }
   delete s;
 }
 
@@ -61,9 +91,7 @@ jlong Java_com_aldebaran_qi_Session_qiSessionConnect(JNIEnv *env, jobject QI_UNU
   // After this function return, callbacks are going to be set on new created Future.
   // Save the JVM pointer here to avoid big issues when callbacks will be called.
   JVM(env);
-  qi::Future<qi::AnyValue> *fref = new qi::Future<qi::AnyValue>();
   qi::Promise<qi::AnyValue> promise;
-  *fref = promise.future();
   qi::Session *s = reinterpret_cast<qi::Session*>(pSession);
   try
   {
@@ -74,7 +102,7 @@ jlong Java_com_aldebaran_qi_Session_qiSessionConnect(JNIEnv *env, jobject QI_UNU
   {
     promise.setError(e.what());
   }
-  return (jlong) fref;
+  return java_future_handle(promise.future());
 }
 
 void Java_com_aldebaran_qi_Session_qiSessionClose(JNIEnv* QI_UNUSED(env), jobject QI_UNUSED(obj), jlong pSession)
@@ -95,6 +123,9 @@ jobject   Java_com_aldebaran_qi_Session_service(JNIEnv* env, jobject QI_UNUSED(o
   try
   {
     *obj = s->service(serviceName);
+    boost::shared_ptr<qi::CallLimiter> limiter = sessionLimiter(s, false);
+    if (limiter)
+      qi::ProxyPolicy::get(obj)->setSessionLimiter(limiter);
     JNIObject jniProxy(obj);
     return jniProxy.object();
   }
@@ -106,6 +137,25 @@ jobject   Java_com_aldebaran_qi_Session_service(JNIEnv* env, jobject QI_UNUSED(o
   }
 }
 
+void  Java_com_aldebaran_qi_Session_setCallLimits(JNIEnv* env, jobject QI_UNUSED(obj), jlong pSession, jint maxInFlight, jlong maxBytes, jint overflow)
+{
+  qi::Session *s = reinterpret_cast<qi::Session*>(pSession);
+
+  if (maxInFlight < 0 || maxBytes < 0)
+  {
+    throwJavaError(env, "Call limits must be positive.");
+    return;
+  }
+  sessionLimiter(s, true)->setLimits(maxInFlight, static_cast<size_t>(maxBytes), static_cast<qi::CallLimiter::Overflow>(overflow));
+}
+
+jlongArray Java_com_aldebaran_qi_Session_callCounters(JNIEnv* env, jobject QI_UNUSED(obj), jlong pSession)
+{
+  qi::Session *s = reinterpret_cast<qi::Session*>(pSession);
+
+  return java_call_counters(env, sessionLimiter(s, false));
+}
+
 jint  Java_com_aldebaran_qi_Session_registerService(JNIEnv *env, jobject QI_UNUSED(jobj), jlong pSession, jstring jname, jobject object)
 {
   qi::Session*    session = reinterpret_cast<qi::Session*>(pSession);
@@ -158,6 +208,7 @@ void      Java_com_aldebaran_qi_Session_onDisconnected(JNIEnv *env, jobject jobj
   signature = callbackName + "::(s)";
   data = new qi_method_info(jobjectInstance, signature, jobj);
   gInfoHandler.push(data);
+  prepare_java_method(env, data);
 
   session->disconnected.connect(
       qi::AnyFunction::fromDynamicFunction(
@@ -0,0 +1,141 @@
+/*
+**
+** Copyright (C) 2015 Aldebaran Robotics
+** See COPYING for the license
+*/
+
+#include <qi/log.hpp>
+
+#include <timerwheel.hpp>
+
+qiLogCategory("qimessaging.jni");
+
+/// Deadlines are enforced with this precision.
+#define QI_TIMER_TICK_MS 10
+/// Slots of the wheel: one turn covers QI_TIMER_TICK_MS * QI_TIMER_SLOTS.
+#define QI_TIMER_SLOTS 512
+
+static qi::TimerWheel* gTimerWheel = 0;
+static boost::mutex    gTimerWheelMutex;
+
+qi::TimerWheel* java_timer_wheel()
+{
+  boost::mutex::scoped_lock lock(gTimerWheelMutex);
+
+  // Never deleted: pending deadlines may fire until the process exits.
+  if (!gTimerWheel)
+    gTimerWheel = new qi::TimerWheel(qi::MilliSeconds(QI_TIMER_TICK_MS), QI_TIMER_SLOTS);
+  return gTimerWheel;
+}
+
+namespace qi {
+
+  TimerWheel::TimerWheel(qi::MilliSeconds tick, unsigned int slotCount)
+    : _slots(slotCount ? slotCount : 1)
+    , _tick(tick.count() > 0 ? tick : qi::MilliSeconds(1))
+    , _cursor(0)
+    , _nextId(1)
+    , _stopping(false)
+  {
+    _next = qi::SteadyClock::now() + _tick;
+    _thread = new boost::thread(boost::bind(&TimerWheel::run, this));
+  }
+
+  TimerWheel::~TimerWheel()
+  {
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+      _stopping = true;
+    }
+    _cond.notify_all();
+    _thread->join();
+    delete _thread;
+  }
+
+  qi::uint64_t TimerWheel::schedule(qi::MilliSeconds delay, const boost::function<void ()>& callback)
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+
+    // Count from the next tick: part of the current one is already elapsed.
+    qi::SteadyClock::time_point expiry = qi::SteadyClock::now() + delay;
+    qi::Duration tick = _tick;
+    qi::uint64_t ticks = 0; // Ticks after the next one
+    if (expiry > _next)
+      ticks = ((expiry - _next).count() + tick.count() - 1) / tick.count();
+
+    unsigned int slot = (_cursor + 1 + ticks) % _slots.size();
+    Timer timer;
+    timer.id = _nextId++;
+    timer.rounds = ticks / _slots.size();
+    timer.callback = callback;
+
+    Slot::iterator it = _slots[slot].insert(_slots[slot].end(), timer);
+    _timers[timer.id] = std::make_pair(slot, it);
+    return timer.id;
+  }
+
+  void TimerWheel::cancel(qi::uint64_t id)
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+
+    boost::unordered_map<qi::uint64_t, std::pair<unsigned int, Slot::iterator> >::iterator it = _timers.find(id);
+    if (it == _timers.end())
+      return;
+    _slots[it->second.first].erase(it->second.second);
+    _timers.erase(it);
+  }
+
+  void TimerWheel::run()
+  {
+    while (true)
+    {
+      std::vector<boost::function<void ()> > expired;
+      {
+        boost::mutex::scoped_lock lock(_mutex);
+
+        qi::SteadyClock::time_point now = qi::SteadyClock::now();
+        while (!_stopping && now < _next)
+        {
+          _cond.wait_for(lock, _next - now);
+          now = qi::SteadyClock::now();
+        }
+        if (_stopping)
+          return;
+
+        // Catch up ticks missed while callbacks ran.
+        while (_next <= now)
+        {
+          _next += _tick;
+          _cursor = (_cursor + 1) % _slots.size();
+
+          Slot& slot = _slots[_cursor];
+          for (Slot::iterator it = slot.begin(); it != slot.end();)
+          {
+            if (it->rounds > 0)
+            {
+              --it->rounds;
+              ++it;
+              continue;
+            }
+            expired.push_back(it->callback);
+            _timers.erase(it->id);
+            it = slot.erase(it);
+          }
+        }
+      }
+
+      for (std::vector<boost::function<void ()> >::iterator it = expired.begin(); it != expired.end(); ++it)
+      {
+        try
+        {
+          (*it)();
+        }
+        catch (std::exception& e)
+        {
+          qiLogError() << "Timer callback failed: " << e.what();
+        }
+      }
+    }
+  }
+
+} // !qi
@@ -23,11 +23,24 @@ public class AnyObject {
   private static native long     property(long pObj, String property);
   private static native long     setProperty(long pObj, String property, Object value);
   private static native long     asyncCall(long pObject, String method, Object[] args);
+  private static native long     asyncCallWithTimeout(long pObject, String method, Object[] args, long timeoutMs);
+  private static native long     asyncCallI(long pObject, String method, int a);
+  private static native long     asyncCallF(long pObject, String method, float a);
+  private static native long     asyncCallB(long pObject, String method, boolean a);
+  private static native long     asyncCallS(long pObject, String method, String a);
+  private static native long     asyncCallII(long pObject, String method, int a, int b);
+  private static native long     asyncCallIF(long pObject, String method, int a, float b);
+  private static native long     asyncCallFF(long pObject, String method, float a, float b);
   private static native String   printMetaObject(long pObject);
   private static native void     destroy(long pObj);
-  private static native long     connect(long pObject, String method, Object instance, String className, String eventName);
+  private static native long     connect(long pObject, String method, Object instance, String className, String eventName, int lane);
   private static native long     disconnect(long pObject, long subscriberId);
   private static native long     post(long pObject, String name, Object[] args);
+  private static native void     setCallCollapsing(long pObject, String method, boolean enabled);
+  private static native void     setCallCache(long pObject, String method, long ttlMs, long maxBytes);
+  private static native void     setCacheInvalidationSignal(long pObject, String signal);
+  private static native void     setCallLimits(long pObject, int maxInFlight, long maxBytes, int overflow);
+  private static native long[]   callCounters(long pObject);
 
   public static native Object decodeJSON(String str);
   public static native String encodeJSON(Object obj);
@@ -61,30 +74,226 @@ public class AnyObject {
    */
   public <T> Future<T> call(String method, Object ... args) throws CallError
   {
-    com.aldebaran.qi.Future<T> ret = null;
+    try
+    {
+      return this.<T>future(AnyObject.asyncCall(_p, method, args));
+    } catch (Exception e)
+    {
+      throw callError(e);
+    }
+  }
+
+  /*
+   * Typed calls: primitive arguments are given to native code as is,
+   * without boxing them or allocating an argument array.
+   * They have their own names: as call() overloads, they would be chosen
+   * by widening over call(String, Object...), sending a long as a float.
+   */
+
+  public <T> Future<T> callInt(String method, int a) throws CallError
+  {
+    try
+    {
+      return this.<T>future(AnyObject.asyncCallI(_p, method, a));
+    } catch (Exception e)
+    {
+      throw callError(e);
+    }
+  }
+
+  public <T> Future<T> callFloat(String method, float a) throws CallError
+  {
+    try
+    {
+      return this.<T>future(AnyObject.asyncCallF(_p, method, a));
+    } catch (Exception e)
+    {
+      throw callError(e);
+    }
+  }
+
+  public <T> Future<T> callBoolean(String method, boolean a) throws CallError
+  {
+    try
+    {
+      return this.<T>future(AnyObject.asyncCallB(_p, method, a));
+    } catch (Exception e)
+    {
+      throw callError(e);
+    }
+  }
+
+  public <T> Future<T> callString(String method, String a) throws CallError
+  {
+    if (a == null)
+      return this.<T>call(method, new Object[] { null });
 
     try
     {
-      ret = new com.aldebaran.qi.Future<T>(AnyObject.asyncCall(_p, method, args));
+      return this.<T>future(AnyObject.asyncCallS(_p, method, a));
+    } catch (Exception e)
+    {
+      throw callError(e);
+    }
+  }
+
+  public <T> Future<T> callIntInt(String method, int a, int b) throws CallError
+  {
+    try
+    {
+      return this.<T>future(AnyObject.asyncCallII(_p, method, a, b));
+    } catch (Exception e)
+    {
+      throw callError(e);
+    }
+  }
+
+  public <T> Future<T> callIntFloat(String method, int a, float b) throws CallError
+  {
+    try
+    {
+      return this.<T>future(AnyObject.asyncCallIF(_p, method, a, b));
+    } catch (Exception e)
+    {
+      throw callError(e);
+    }
+  }
+
+  public <T> Future<T> callFloatFloat(String method, float a, float b) throws CallError
+  {
+    try
+    {
+      return this.<T>future(AnyObject.asyncCallFF(_p, method, a, b));
     } catch (Exception e)
     {
-      throw new CallError(e.getMessage());
+      throw callError(e);
     }
+  }
+
+  /// Error of a call that could not be made, typed errors (RemoteError, ConversionError...) are kept as is
+  private static CallError callError(Exception e)
+  {
+    if (e instanceof CallError)
+      return (CallError) e;
+    return new CallError(e.getMessage());
+  }
+
+  private <T> Future<T> future(long pFuture) throws CallError
+  {
+    Future<T> ret = new Future<T>(pFuture);
 
     if (ret.isValid() == false)
       throw new CallError("Future is null.");
+    return ret;
+  }
 
+  /**
+   * Perform asynchronous call and return Future return value.
+   * Callbacks added to the returned future without explicit priority
+   * are dispatched with given priority.
+   * @param priority Priority of the continuations of the call
+   * @param method Method name to call
+   * @param args Arguments to be forward to remote method
+   * @return Future method return value
+   * @throws CallError
+   */
+  public <T> Future<T> call(Priority priority, String method, Object ... args) throws CallError
+  {
+    Future<T> ret = this.<T>call(method, args);
+    ret.setPriority(priority);
+    return ret;
+  }
+
+  /**
+   * Perform asynchronous call that fails if it is not finished in time.
+   * Once timeoutMs is elapsed, the returned Future is in error and the call
+   * is canceled, so that nothing is kept for its late result.
+   * @param timeoutMs Deadline of the call in milliseconds, 0 for no deadline
+   * @param method Method name to call
+   * @param args Arguments to be forward to remote method
+   * @return Future method return value
+   * @throws CallError
+   */
+  public <T> Future<T> callWithTimeout(long timeoutMs, String method, Object ... args) throws CallError
+  {
     try
     {
-      return ret;
+      return this.<T>future(AnyObject.asyncCallWithTimeout(_p, method, args, timeoutMs));
     } catch (Exception e)
     {
-      throw new CallError(e.getMessage());
+      throw callError(e);
     }
   }
 
+  /**
+   * Collapse identical calls to an idempotent method.
+   * While a call to method with given arguments is in flight, further calls
+   * with the same arguments share its Future instead of sending a new request.
+   * Only enable this on methods without side effects.
+   * @param method Method name, with or without signature
+   * @param enabled True to collapse calls, false to send every call
+   */
+  public void setCallCollapsing(String method, boolean enabled)
+  {
+    AnyObject.setCallCollapsing(_p, method, enabled);
+  }
+
+  /**
+   * Cache results of an idempotent method on client side.
+   * A call with the same arguments as a cached one returns a finished Future
+   * holding the cached value, without any request, until ttlMs is elapsed.
+   * Oldest results are evicted when the cache grows over maxBytes.
+   * Results are cached as native values: each call gets its own Java objects.
+   * @param method Method name, with or without signature
+   * @param ttlMs Lifetime of a result in milliseconds, 0 disables the cache
+   * @param maxBytes Maximum size of cached results, in bytes of encoded values
+   * @throws Exception If ttlMs or maxBytes is negative
+   */
+  public void setCallCache(String method, long ttlMs, long maxBytes) throws Exception
+  {
+    AnyObject.setCallCache(_p, method, ttlMs, maxBytes);
+  }
+
+  /**
+   * Clear all cached results each time given signal of the object is triggered.
+   * @see setCallCache
+   * @param signalName Name of the signal, null to stop listening
+   * @throws Exception If signal cannot be connected
+   */
+  public void setCacheInvalidationSignal(String signalName) throws Exception
+  {
+    AnyObject.setCacheInvalidationSignal(_p, signalName);
+  }
+
+  /**
+   * Bound calls in flight through this proxy.
+   * Cached results and calls sharing an identical call in flight are not counted.
+   * Calls beyond limits are handled according to overflow; failed calls
+   * return a Future in error.
+   * @param maxInFlight Maximum number of calls not finished yet, 0 for no limit
+   * @param maxBytes Maximum size of the arguments of calls in flight, 0 for no limit
+   * @param overflow What to do with a call beyond limits
+   * @throws Exception If a limit is negative
+   */
+  public void setCallLimits(int maxInFlight, long maxBytes, OverflowPolicy overflow) throws Exception
+  {
+    AnyObject.setCallLimits(_p, maxInFlight, maxBytes, overflow.ordinal());
+  }
+
+  /**
+   * @return Counters of the calls limited by setCallLimits
+   */
+  public CallCounters callCounters()
+  {
+    return new CallCounters(AnyObject.callCounters(_p));
+  }
+
   /**
    * Connect a callback to a foreign event.
+   * Callbacks of the same event of this object share one subscription:
+   * each event is converted once and given to all of them. They all receive
+   * the same List or Map instances: copy them before modifying them.
+   * The callback is called until disconnect(), even if this object is collected.
    * @param eventName Name of the event
    * @param callback Callback name
    * @param object Instance of class implementing callback
@@ -92,6 +301,21 @@ public class AnyObject {
    * @throws Exception If callback method is not found in object instance.
    */
   public long connect(String eventName, String callback, Object object) throws Exception
+  {
+    return connect(eventName, callback, object, null);
+  }
+
+  /**
+   * Connect a callback to a foreign event, dispatched with given priority.
+   * @see Priority
+   * @param eventName Name of the event
+   * @param callback Callback name
+   * @param object Instance of class implementing callback
+   * @param priority Dispatch lane of the callback, null to call it in qimessaging thread emitting the event
+   * @return an unique subscriber id
+   * @throws Exception If callback method is not found in object instance.
+   */
+  public long connect(String eventName, String callback, Object object, Priority priority) throws Exception
   {
     Class<?extends Object> c = object.getClass();
     Method[] methods = c.getDeclaredMethods();
@@ -104,7 +328,7 @@ public class AnyObject {
 
       // If method name match signature
       if (callback.contains(method.getName()) == true)
-        return AnyObject.connect(_p, callback, object, className, eventName);
+        return AnyObject.connect(_p, callback, object, className, eventName, priority == null ? -1 : priority.ordinal());
     }
 
     throw new Exception("Cannot find " + callback + " in object " + object.toString());
@@ -112,6 +336,7 @@ public class AnyObject {
 
   /**
    * Disconnect a previously registered callback.
+   * The subscription to the event is dropped with its last callback.
    * @param subscriberId id returned by connect()
    *
    */
@@ -0,0 +1,20 @@
+/*
+**  Copyright (C) 2015 Aldebaran Robotics
+**  See COPYING for the license
+*/
+package com.aldebaran.qi;
+
+@SuppressWarnings("serial")
+public class CallCancelledError extends CallError
+{
+
+  /**
+   * Exception thrown when a call has been canceled.
+   * @param e Error message.
+   */
+  public CallCancelledError(String e)
+  {
+    super(e);
+  }
+
+}
@@ -0,0 +1,50 @@
+/*
+**  Copyright (C) 2015 Aldebaran Robotics
+**  See COPYING for the license
+*/
+package com.aldebaran.qi;
+
+/**
+ * Snapshot of the calls tracked by call limits.
+ * @see AnyObject#setCallLimits
+ * @see Session#setCallLimits
+ */
+public class CallCounters
+{
+  private final long inFlight;
+  private final long bytes;
+  private final long rejected;
+  private final long dropped;
+
+  CallCounters(long[] values)
+  {
+    inFlight = values[0];
+    bytes = values[1];
+    rejected = values[2];
+    dropped = values[3];
+  }
+
+  /// Number of calls not finished yet
+  public long getInFlight()
+  {
+    return inFlight;
+  }
+
+  /// Size of the arguments of calls in flight, if a byte limit is set
+  public long getBytes()
+  {
+    return bytes;
+  }
+
+  /// Number of calls failed by OverflowPolicy.FailFast
+  public long getRejected()
+  {
+    return rejected;
+  }
+
+  /// Number of calls failed by OverflowPolicy.DropOldest
+  public long getDropped()
+  {
+    return dropped;
+  }
+}
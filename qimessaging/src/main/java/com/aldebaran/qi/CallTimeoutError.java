@@ -0,0 +1,20 @@
+/*
+**  Copyright (C) 2015 Aldebaran Robotics
+**  See COPYING for the license
+*/
+package com.aldebaran.qi;
+
+@SuppressWarnings("serial")
+public class CallTimeoutError extends CallError
+{
+
+  /**
+   * Exception thrown when a call is not finished before its deadline.
+   * @param e Error message.
+   */
+  public CallTimeoutError(String e)
+  {
+    super(e);
+  }
+
+}
@@ -0,0 +1,115 @@
+/*
+**  Copyright (C) 2015 Aldebaran Robotics
+**  See COPYING for the license
+*/
+package com.aldebaran.qi;
+
+import java.io.Closeable;
+import java.util.concurrent.TimeUnit;
+
+/**
+ * Queue of finished futures, for clients making many concurrent calls.
+ * Futures are added with a tag. When they finish, their tag is queued
+ * natively, without calling Java code. Threads drain tags in batches and
+ * take the futures they want:
+ * <pre>
+ * CompletionQueue queue = new CompletionQueue();
+ * for (int i = 0; i &lt; 1000; ++i)
+ *   queue.add(proxy.call("getPose", i), i);
+ * long[] tags = new long[64];
+ * int count = queue.drain(tags, tags.length, 1, TimeUnit.SECONDS);
+ * for (int i = 0; i &lt; count; ++i)
+ *   handle(tags[i], queue.&lt;Pose&gt;take(tags[i]).get());
+ * </pre>
+ */
+public class CompletionQueue implements Closeable
+{
+
+  // Loading QiMessaging JNI layer
+  static
+  {
+    if (!EmbeddedTools.LOADED_EMBEDDED_LIBRARY)
+    {
+      EmbeddedTools loader = new EmbeddedTools();
+      loader.loadEmbeddedLibraries();
+    }
+  }
+
+  // Handle of C++ completion queue, stale once closed
+  private final long _p;
+
+  private static native long   create();
+  private static native void   destroy(long pQueue);
+  private static native void   add(long pQueue, long pFuture, long tag);
+  private static native int    drain(long pQueue, long[] tags, int max, long timeoutMs);
+  private static native Object take(long pQueue, long tag);
+
+  public CompletionQueue()
+  {
+    _p = CompletionQueue.create();
+  }
+
+  /**
+   * Queue tag when future finishes, whatever its result.
+   * @param future Future to watch
+   * @param tag Identifier of the future, unique among futures not taken yet:
+   *        adding a tag in use throws an exception
+   */
+  public void add(Future<?> future, long tag)
+  {
+    CompletionQueue.add(_p, future.handle(), tag);
+  }
+
+  /**
+   * Get tags of finished futures, oldest first.
+   * @param tags Array receiving tags
+   * @param max Maximum number of tags to get
+   * @param timeout Maximum time to wait for a first future if none is finished, 0 to return at once
+   * @return Number of tags copied in tags, 0 on timeout or if the queue is closed while waiting
+   */
+  public int drain(long[] tags, int max, long timeout, TimeUnit unit)
+  {
+    return CompletionQueue.drain(_p, tags, max, unit.toMillis(timeout));
+  }
+
+  /**
+   * Get tags of finished futures, waiting as long as needed for the first one.
+   * @see #drain(long[], int, long, TimeUnit)
+   */
+  public int drain(long[] tags, int max)
+  {
+    return CompletionQueue.drain(_p, tags, max, -1);
+  }
+
+  /**
+   * Take the finished future of tag, its value is only converted when asked for.
+   * @param tag Tag given by drain()
+   * @return Future of tag, null if it is not finished or already taken
+   */
+  @SuppressWarnings("unchecked")
+  public <T> Future<T> take(long tag)
+  {
+    return (Future<T>) CompletionQueue.take(_p, tag);
+  }
+
+  /**
+   * Release the native queue now, threads waiting in drain() return.
+   * Other methods throw once the queue is closed, closing it again does nothing.
+   */
+  public void close()
+  {
+    CompletionQueue.destroy(_p);
+  }
+
+  /**
+   * Called by garbage collector
+   * Finalize is overriden to manually delete C++ data, if not closed yet
+   */
+  @Override
+  protected void finalize() throws Throwable
+  {
+    close();
+    super.finalize();
+  }
+
+}
@@ -0,0 +1,20 @@
+/*
+**  Copyright (C) 2015 Aldebaran Robotics
+**  See COPYING for the license
+*/
+package com.aldebaran.qi;
+
+@SuppressWarnings("serial")
+public class ConversionError extends CallError
+{
+
+  /**
+   * Exception thrown when call arguments or result cannot be converted.
+   * @param e Error message.
+   */
+  public ConversionError(String e)
+  {
+    super(e);
+  }
+
+}
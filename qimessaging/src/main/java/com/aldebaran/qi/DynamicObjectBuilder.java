@@ -23,10 +23,12 @@ public class DynamicObjectBuilder {
   private static native long   create();
   private static native void   destroy(long pObject);
   private static native Object object(long pObjectBuilder);
-  private static native long   advertiseMethod(long pObjectBuilder, String method, Object instance, String className, String description);
+  private static native long   advertiseMethod(long pObjectBuilder, String method, Object instance, String className, String description, MethodOptions options);
   private static native long   advertiseSignal(long pObjectBuilder, String eventSignature);
   private static native long   advertiseProperty(long pObjectBuilder, String name, Class<?> propertyBase);
   private static native long   advertiseThreadSafeness(long pObjectBuilder, boolean isThreadSafe);
+  private static native long   setExecutor(long pObjectBuilder, int threadCount, int maxQueueSize);
+  private static native long   setAdmissionLimits(long pObjectBuilder, int maxConcurrent, int maxQueued, long maxQueueDelayMs);
 
   /// Possible thread models for an object
   public enum ObjectThreadingModel
@@ -44,11 +46,30 @@ public class DynamicObjectBuilder {
 
   /**
    * Bind method from a qimessaging.service to GenericObject.
+   * The implementation may return a com.aldebaran.qi.Future instead of the
+   * advertised type (see Promise): the call then completes with that future,
+   * without keeping a qimessaging thread busy.
+   * A caller living in this JVM gives its arguments as is when they already have
+   * the advertised type, or when it is dynamic (m), and gets the returned object
+   * as is: such a List or Map is shared with the caller, copy it before modifying it.
    * @param methodSignature Signature of method to bind.
    * @param service Service implementing method.
    * @throws Exception on error.
    */
   public void advertiseMethod(String methodSignature, QiService service, String description) throws QiException
+  {
+    advertiseMethod(methodSignature, service, description, null);
+  }
+
+  /**
+   * Bind method from a qimessaging.service to GenericObject with specific settings.
+   * @see MethodOptions
+   * @param methodSignature Signature of method to bind.
+   * @param service Service implementing method.
+   * @param options Method settings, null for defaults.
+   * @throws Exception on error.
+   */
+  public void advertiseMethod(String methodSignature, QiService service, String description, MethodOptions options) throws QiException
   {
     Class<?extends Object> c = service.getClass();
     Method[] methods = c.getDeclaredMethods();
@@ -56,6 +77,15 @@ public class DynamicObjectBuilder {
     if (_p == 0)
       throw new QiException("Invalid object.\n");
 
+    // Calls of a batched method are handled by its batch handler.
+    if (options != null && options.isBatched())
+    {
+      String className = service.getClass().getName().replace('.', '/');
+      if (DynamicObjectBuilder.advertiseMethod(_p, methodSignature, service, className, description, options) == 0)
+        throw new QiException("Cannot register method " + methodSignature);
+      return;
+    }
+
     for (Method method : methods)
     {
       String className = service.getClass().toString();
@@ -65,7 +95,7 @@ public class DynamicObjectBuilder {
       // If method name match signature
       if (methodSignature.contains(method.getName()) == true)
       {
-        if (DynamicObjectBuilder.advertiseMethod(_p, methodSignature, service, className, description) == 0)
+        if (DynamicObjectBuilder.advertiseMethod(_p, methodSignature, service, className, description, options) == 0)
           throw new QiException("Cannot register method " + methodSignature);
         return;
       }
@@ -108,6 +138,42 @@ public class DynamicObjectBuilder {
     DynamicObjectBuilder.advertiseThreadSafeness(_p, threadModel == ObjectThreadingModel.MultiThread);
   }
 
+  /**
+   * Run Java implementations of this object's methods on a dedicated pool
+   * of threads instead of qimessaging event loop threads, so that a slow
+   * service does not delay the others.
+   * Must be called before the object is registered.
+   * @param threadCount number of threads, attached to the JVM once for all.
+   *        0 runs methods on qimessaging threads again.
+   * @param maxQueueSize maximum number of calls waiting for a thread, 0 for no limit.
+   *        Calls beyond this limit fail immediately.
+   */
+  public void setExecutor(int threadCount, int maxQueueSize) throws QiException
+  {
+    if (_p == 0)
+      throw new QiException("Invalid object");
+    DynamicObjectBuilder.setExecutor(_p, threadCount, maxQueueSize);
+  }
+
+  /**
+   * Bound calls to Java implementations of this object's methods, so that
+   * latency stays bounded under overload instead of growing with the backlog.
+   * Calls beyond limits fail immediately with a "Service overloaded" error.
+   * Memoized results are served without limits.
+   * Must be called before the object is registered.
+   * @param maxConcurrent number of calls running at once, others wait in a queue. 0 for no limit.
+   * @param maxQueued number of calls waiting, further calls are rejected. 0 for no limit.
+   * @param maxQueueDelayMs calls that waited longer when their turn comes are
+   *        shed instead of run. 0 for no limit.
+   * Setting all limits to 0 removes admission control.
+   */
+  public void setAdmissionLimits(int maxConcurrent, int maxQueued, long maxQueueDelayMs) throws QiException
+  {
+    if (_p == 0)
+      throw new QiException("Invalid object");
+    DynamicObjectBuilder.setAdmissionLimits(_p, maxConcurrent, maxQueued, maxQueueDelayMs);
+  }
+
   /**
    * Instantiate new AnyObject after builder template.
    * @see AnyObject
@@ -0,0 +1,26 @@
+/*
+**  Copyright (C) 2015 Aldebaran Robotics
+**  See COPYING for the license
+*/
+package com.aldebaran.qi;
+
+/**
+ * Continuation of a com.aldebaran.qi.Future.
+ * @see Future#then(Function)
+ * @see Future#andThen(Function)
+ *
+ * @param <P> Type of the argument: the finished Future, or its value
+ * @param <R> Type of the result
+ */
+public interface Function<P, R>
+{
+
+  /**
+   * Called once the future is finished, in the qimessaging thread finishing it.
+   * @param arg Finished Future, or its value
+   * @return Value of the Future returned by then() or andThen()
+   * @throws Exception Error of the Future returned by then() or andThen()
+   */
+  public R execute(P arg) throws Exception;
+
+}
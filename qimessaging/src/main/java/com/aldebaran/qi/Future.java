@@ -4,16 +4,20 @@
 */
 package com.aldebaran.qi;
 
+import java.io.Closeable;
+import java.util.List;
+import java.util.concurrent.CountDownLatch;
 import java.util.concurrent.ExecutionException;
 import java.util.concurrent.TimeUnit;
 import java.util.concurrent.TimeoutException;
+import java.util.concurrent.atomic.AtomicReference;
 
 /**
  * @author proullon
  *
  * @param <T>
  */
-public class Future <T>
+public class Future <T> implements Closeable
 {
 
   // Loading QiMessaging JNI layer
@@ -26,18 +30,44 @@ public class Future <T>
     }
   }
 
-  // C++ Future
+  // Handle of C++ Future, stale once closed
   private long  _fut;
 
+  // Default priority of callbacks, null to run them in qimessaging threads
+  private Priority _priority = null;
+
+  // Java value, converted once by the first successful get() or eagerly when the future finishes
+  private Object           _value = null;
+  private volatile boolean _hasValue = false;
+  // Error given by native code when the future finishes, if converted eagerly
+  private volatile Throwable _error = null;
+  // Set with _error when the future is canceled
+  private volatile boolean _cancelled = false;
+  // Counted down by native code when the future finishes, set once if converted eagerly
+  private final AtomicReference<CountDownLatch> _finished = new AtomicReference<CountDownLatch>();
+
+  // Set by close(): the converted value is dropped, and methods reach native code that throws
+  private volatile boolean _closed = false;
+
+  // Wait in Java instead of in native code, see setManagedWait()
+  private volatile boolean _managedWait = false;
+
   // Native C API object functions
   private static native boolean qiFutureCallCancel(long pFuture);
   private static native Object  qiFutureCallGet(long pFuture);
   private static native Object  qiFutureCallGetWithTimeout(long pFuture, int timeout);
   private static native boolean qiFutureCallIsCancelled(long pFuture);
   private static native boolean qiFutureCallIsDone(long pFuture);
-  private static native boolean qiFutureCallConnect(long pFuture, Object callback, String className, Object[] args);
+  private static native boolean qiFutureCallConnect(long pFuture, Object callback, String className, Object[] args, int lane);
   private static native void    qiFutureCallWaitWithTimeout(long pFuture, int timeout);
   private static native void    qiFutureDestroy(long pFuture);
+  private static native boolean qiFutureIsValid(long pFuture);
+  private static native long    qiFutureThen(long pFuture, Object function, boolean withValue, int lane);
+  private static native void    qiFutureCallComplete(long pFuture, Object adapter, int lane);
+  private static native long    qiFutureWhenAll(long[] pFutures);
+  private static native long    qiFutureWhenAny(long[] pFutures);
+  private static native boolean qiFutureWaitAll(long[] pFutures, int timeout);
+  private static native int     qiFutureWaitAny(long[] pFutures, int timeout);
 
   private Future()
   {
@@ -49,9 +79,32 @@ public class Future <T>
     _fut = pFuture;
   }
 
+  /// Timeout of a native wait: clamped to int, a positive timeout never becomes 0 (wait forever)
+  private static int timeoutMillis(long timeout, TimeUnit unit)
+  {
+    long ms = unit.toMillis(timeout);
+    if (ms > Integer.MAX_VALUE)
+      return Integer.MAX_VALUE;
+    if (ms == 0 && timeout > 0)
+      return 1;
+    return (int) ms;
+  }
+
   public void sync(long timeout, TimeUnit unit)
   {
-    Future.qiFutureCallWaitWithTimeout(_fut, (int) unit.toMillis(timeout));
+    if (_managedWait && !_closed)
+    {
+      try
+      {
+        awaitFinished(timeout, unit);
+      } catch (InterruptedException e)
+      {
+        Thread.currentThread().interrupt();
+      }
+      return;
+    }
+
+    Future.qiFutureCallWaitWithTimeout(_fut, timeoutMillis(timeout, unit));
   }
 
   public void sync()
@@ -67,12 +120,75 @@ public class Future <T>
    * @since 1.20
    */
   public boolean addCallback(Callback<?> callback, Object ... args)
+  {
+    return addCallback(_priority, callback, args);
+  }
+
+  /**
+   * Callbacks to future can be set, dispatched with given priority.
+   * @see Priority
+   * @param priority Dispatch lane of the callback, null to call it in qimessaging thread finishing the future
+   * @param callback com.aldebaran.qi.Callback implementation
+   * @param args Argument to be forwarded to callback functions.
+   * @return true on success.
+   */
+  public boolean addCallback(Priority priority, Callback<?> callback, Object ... args)
   {
     String className = callback.getClass().toString();
     className = className.substring(6); // Remove "class "
     className = className.replace('.', '/');
 
-    return qiFutureCallConnect(_fut, callback, className, args);
+    return qiFutureCallConnect(_fut, callback, className, args, priority == null ? -1 : priority.ordinal());
+  }
+
+  private int lane()
+  {
+    return _priority == null ? -1 : _priority.ordinal();
+  }
+
+  /**
+   * Chain a function called once this future is finished, whatever its result.
+   * The function is called by qimessaging: no Java thread waits for this future.
+   * Canceling the returned future cancels this one.
+   * @param function Function called with this finished future
+   * @return Future of the result of function, failing if function throws
+   */
+  public <R> Future<R> then(Function<Future<T>, R> function)
+  {
+    return new Future<R>(Future.qiFutureThen(_fut, function, false, lane()));
+  }
+
+  /**
+   * Chain a function called with the value of this future.
+   * If this future fails or is canceled, function is not called and the
+   * returned future fails or is canceled the same way.
+   * The value is converted in the qimessaging thread finishing this future.
+   * @param function Function called with the value of this future
+   * @return Future of the result of function, failing if function throws
+   */
+  public <R> Future<R> andThen(Function<T, R> function)
+  {
+    return new Future<R>(Future.qiFutureThen(_fut, function, true, lane()));
+  }
+
+  /**
+   * java.util.concurrent.Future completed when this future finishes.
+   * Its value is converted once, in the qimessaging thread finishing this future,
+   * so that its get() methods never call native code.
+   * Errors are reported as ExecutionException caused by a CallError,
+   * cancellation as CancellationException.
+   */
+  public java.util.concurrent.Future<T> toJavaFuture()
+  {
+    FutureAdapter<T> adapter = new FutureAdapter<T>(this);
+
+    Future.qiFutureCallComplete(_fut, adapter, lane());
+    return adapter;
+  }
+
+  void setPriority(Priority priority)
+  {
+    _priority = priority;
   }
 
   public boolean cancel()
@@ -81,24 +197,151 @@ public class Future <T>
     return qiFutureCallCancel(_fut);
   }
 
+  /**
+   * Convert the value in the qimessaging thread finishing the future,
+   * get() then waits for it and returns it without calling native code.
+   * @return this future
+   */
+  public Future<T> convertEagerly()
+  {
+    finished();
+    return this;
+  }
+
+  /**
+   * Choose how get() and sync() wait for this future if it is not finished yet.
+   * By default the calling thread blocks in native code, which pins the carrier
+   * of a virtual thread. With managed wait, the future is converted eagerly and
+   * the calling thread parks in Java until native code signals its completion.
+   * @param enabled true to wait in Java
+   * @return this future
+   */
+  public Future<T> setManagedWait(boolean enabled)
+  {
+    _managedWait = enabled;
+    if (enabled)
+      finished();
+    return this;
+  }
+
+  /**
+   * Latch counted down when the future finishes, the native completion is connected once.
+   * Lock free: a thread waiting in Java never blocks on a monitor held across native code.
+   */
+  private CountDownLatch finished()
+  {
+    CountDownLatch latch = _finished.get();
+    if (latch != null)
+      return latch;
+
+    latch = new CountDownLatch(1);
+    if (!_finished.compareAndSet(null, latch))
+      return _finished.get();
+    // Only the thread publishing the latch connects the completion.
+    Future.qiFutureCallComplete(_fut, this, -1);
+    return latch;
+  }
+
+  /**
+   * Park until the future is finished.
+   * @param timeout Maximum time to wait, 0 to wait forever
+   * @return false on timeout
+   */
+  private boolean awaitFinished(long timeout, TimeUnit unit) throws InterruptedException
+  {
+    if (_hasValue && !_closed)
+      return true;
+    if (timeout == 0)
+    {
+      finished().await();
+      return true;
+    }
+    return finished().await(timeout, unit);
+  }
+
+  private void countDown()
+  {
+    CountDownLatch latch = _finished.get();
+    if (latch != null)
+      latch.countDown();
+  }
+
+  /**
+   * Called by native code when the future finishes with a value, if converted eagerly.
+   */
+  void complete(Object value)
+  {
+    // Keep the object already returned by get()
+    if (!_hasValue && !_closed)
+    {
+      _value = value;
+      _hasValue = true;
+    }
+    countDown();
+  }
+
+  /**
+   * Called by native code when the future fails, if converted eagerly.
+   * The error is thrown again by get().
+   */
+  void fail(Throwable error)
+  {
+    _cancelled = error instanceof CallCancelledError;
+    _error = error;
+    countDown();
+  }
+
+  private CallError managedError()
+  {
+    if (_error == null)
+      return new CallError("Future is closed");
+    if (_error instanceof CallError)
+      return (CallError) _error;
+    return new CallError(_error.getMessage());
+  }
+
+  /**
+   * Value of the future, waiting for it if needed.
+   * Once converted, the value is kept: later calls return the same object,
+   * so a returned List or Map must not be modified, copy it first.
+   */
   @SuppressWarnings("unchecked")
   public T get() throws InterruptedException, CallError
   {
 
     Object ret = null;
 
+    if (_hasValue && !_closed)
+      return (T) _value;
+
+    // Converted eagerly: wait for that conversion instead of making another one.
+    if ((_managedWait || _finished.get() != null) && !_closed)
+    {
+      awaitFinished(0, TimeUnit.MILLISECONDS);
+      if (_hasValue && !_closed)
+        return (T) _value;
+      // Same contract as the native wait below
+      if (_cancelled && !_closed)
+        throw new InterruptedException();
+      throw managedError();
+    }
+
     try
     {
       ret = Future.qiFutureCallGet(_fut);
     } catch (Exception e)
     {
+      // Typed errors (RemoteError, CallTimeoutError...) are thrown as is
+      if (e instanceof CallError)
+        throw (CallError) e;
       throw new CallError(e.getMessage());
     }
 
     if (isCancelled())
       throw new InterruptedException();
 
-    return (T) ret;
+    complete(ret);
+    return (T) _value;
   }
 
   @SuppressWarnings("unchecked")
@@ -107,20 +350,33 @@ public class Future <T>
   {
 
     Object ret = null;
-    int timeoutms = (int) unit.toMillis(timeout);
+    int timeoutms = timeoutMillis(timeout, unit);
+
+    if (_hasValue && !_closed)
+      return (T) _value;
+
+    if ((_managedWait || _finished.get() != null) && !_closed)
+    {
+      if (!_hasValue && !finished().await(timeout, unit))
+        throw new TimeoutException();
+      if (_hasValue && !_closed)
+        return (T) _value;
+      throw new ExecutionException(managedError());
+    }
 
     try
     {
       ret = Future.qiFutureCallGetWithTimeout(_fut, timeoutms);
     } catch (Exception e)
     {
-      throw new ExecutionException(e.getCause());
+      throw new ExecutionException(e);
     }
 
     if (ret == null)
       throw new TimeoutException();
 
-    return (T) ret;
+    complete(ret);
+    return (T) _value;
   }
 
   public boolean isCancelled()
@@ -135,15 +391,81 @@ public class Future <T>
 
   public boolean isValid()
   {
-    if (_fut == 0)
-      return false;
+    return Future.qiFutureIsValid(_fut);
+  }
 
-    return true;
+  /**
+   * Release the C++ future now, instead of when this object is collected.
+   * Other methods throw once the future is closed, even if its value was
+   * already converted. Closing it again does nothing.
+   */
+  public void close()
+  {
+    _closed = true;
+    _hasValue = false;
+    _value = null;
+    Future.qiFutureDestroy(_fut);
+  }
+
+  // Handle of C++ future, for other native classes
+  long handle()
+  {
+    return _fut;
+  }
+
+  private static long[] pointers(Future<?>[] futures)
+  {
+    long[] ret = new long[futures.length];
+
+    for (int i = 0; i < futures.length; ++i)
+      ret[i] = futures[i]._fut;
+    return ret;
+  }
+
+  /**
+   * Combine futures, without a thread per future.
+   * @param futures Futures to wait for
+   * @return Future of the values of all futures, in the same order.
+   * It fails with the first error as soon as one of them fails, without waiting for the others.
+   */
+  public static Future<List<Object>> whenAll(Future<?> ... futures)
+  {
+    return new Future<List<Object>>(Future.qiFutureWhenAll(pointers(futures)));
+  }
+
+  /**
+   * Combine futures, without a thread per future.
+   * @param futures Futures to wait for
+   * @return Future of the index of the first finished future, whatever its result
+   */
+  public static Future<Integer> whenAny(Future<?> ... futures)
+  {
+    return new Future<Integer>(Future.qiFutureWhenAny(pointers(futures)));
+  }
+
+  /**
+   * Block until all futures are finished, whatever their result.
+   * @param timeout Maximum time to wait, 0 to wait forever
+   * @return true if all futures are finished, false on timeout
+   */
+  public static boolean waitAll(Future<?>[] futures, long timeout, TimeUnit unit)
+  {
+    return Future.qiFutureWaitAll(pointers(futures), timeoutMillis(timeout, unit));
+  }
+
+  /**
+   * Block until one of futures is finished, whatever its result.
+   * @param timeout Maximum time to wait, 0 to wait forever
+   * @return index of the first finished future, -1 on timeout
+   */
+  public static int waitAny(Future<?>[] futures, long timeout, TimeUnit unit)
+  {
+    return Future.qiFutureWaitAny(pointers(futures), timeoutMillis(timeout, unit));
   }
 
   /**
    * Called by garbage collector
-   * Finalize is overriden to manually delete C++ data
+   * Finalize is overriden to manually delete C++ data, if not closed yet
    */
   @Override
   protected void finalize() throws Throwable
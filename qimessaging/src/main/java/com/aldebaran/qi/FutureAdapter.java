@@ -0,0 +1,91 @@
+/*
+**  Copyright (C) 2015 Aldebaran Robotics
+**  See COPYING for the license
+*/
+package com.aldebaran.qi;
+
+import java.util.concurrent.CancellationException;
+import java.util.concurrent.CountDownLatch;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.TimeoutException;
+
+/**
+ * java.util.concurrent.Future view of a com.aldebaran.qi.Future.
+ * It is completed by native code when the future finishes: get() only
+ * reads the converted value and never calls native code.
+ * @see Future#toJavaFuture()
+ *
+ * @param <T> Type of the value
+ */
+class FutureAdapter<T> implements java.util.concurrent.Future<T>
+{
+
+  private final Future<T>      _future;
+  private final CountDownLatch _done = new CountDownLatch(1);
+  private Object               _value = null;
+  private Throwable            _error = null;
+
+  FutureAdapter(Future<T> future)
+  {
+    _future = future;
+  }
+
+  /**
+   * Called by native code when the future finishes with a value.
+   */
+  void complete(Object value)
+  {
+    _value = value;
+    _done.countDown();
+  }
+
+  /**
+   * Called by native code when the future fails or is canceled.
+   */
+  void fail(Throwable error)
+  {
+    _error = error;
+    _done.countDown();
+  }
+
+  public boolean cancel(boolean mayInterruptIfRunning)
+  {
+    return _future.cancel();
+  }
+
+  public boolean isCancelled()
+  {
+    return isDone() && _error instanceof CallCancelledError;
+  }
+
+  public boolean isDone()
+  {
+    return _done.getCount() == 0;
+  }
+
+  public T get() throws InterruptedException, ExecutionException
+  {
+    _done.await();
+    return result();
+  }
+
+  public T get(long timeout, TimeUnit unit) throws InterruptedException,
+  ExecutionException, TimeoutException
+  {
+    if (!_done.await(timeout, unit))
+      throw new TimeoutException();
+    return result();
+  }
+
+  @SuppressWarnings("unchecked")
+  private T result() throws ExecutionException
+  {
+    if (_error instanceof CallCancelledError)
+      throw new CancellationException(_error.getMessage());
+    if (_error != null)
+      throw new ExecutionException(_error);
+    return (T) _value;
+  }
+
+}
@@ -0,0 +1,140 @@
+/*
+**  Copyright (C) 2015 Aldebaran Robotics
+**  See COPYING for the license
+*/
+package com.aldebaran.qi;
+
+/**
+ * Settings of a method bound by DynamicObjectBuilder.advertiseMethod.
+ * Fields are read by native code when the method is advertised.
+ * @see DynamicObjectBuilder
+ */
+public class MethodOptions {
+
+  /// Concurrency of a method with the other methods of its object
+  public enum Concurrency
+  {
+    /// Runs in parallel with any call of a non exclusive method
+    Concurrent,
+    /// Runs alone: no other call of the object runs at the same time
+    Exclusive,
+    /// Runs in parallel with non exclusive calls, but never with a call having the same key argument
+    Strand
+  }
+
+  private long memoizeTtlMs = 0;
+  private int  memoizeMaxEntries = 0;
+  private boolean cancellable = false;
+  private int  concurrency = -1;
+  private int  strandKey = 0;
+  private long deadlineMs = 0;
+  private String batchHandler = null;
+  private int  maxBatchSize = 0;
+
+  public MethodOptions()
+  {
+  }
+
+  /**
+   * Serve results of a deterministic method from a native cache.
+   * Calls with the same arguments as a cached one return its result
+   * without calling Java, until ttlMs is elapsed.
+   * Results are kept as native values: each caller gets its own Java objects.
+   * @param ttlMs Lifetime of a result in milliseconds, 0 disables memoization
+   * @param maxEntries Maximum number of results kept, least recently used are dropped
+   * @return this, to chain settings
+   */
+  public MethodOptions setMemoization(long ttlMs, int maxEntries)
+  {
+    memoizeTtlMs = ttlMs;
+    memoizeMaxEntries = maxEntries;
+    return this;
+  }
+
+  /**
+   * Let the implementation see cancel requests of its callers through
+   * QiContext.isCancelled(), so that it can stop early.
+   * A cancellable method never runs in the thread that received the call.
+   * @see QiContext
+   * @param enabled true to make method cancellable
+   * @return this, to chain settings
+   */
+  public MethodOptions setCancellable(boolean enabled)
+  {
+    cancellable = enabled;
+    return this;
+  }
+
+  /**
+   * Set how calls of this method may overlap with other calls of the object.
+   * Once a method of an object has a concurrency, qimessaging stops
+   * serializing calls of the whole object: methods without concurrency are
+   * Exclusive on a SingleThread object and Concurrent on a MultiThread one.
+   * Calls that cannot run yet wait in a queue, without holding a thread.
+   * @param mode Concurrent or Exclusive, use setStrand for Strand
+   * @return this, to chain settings
+   */
+  public MethodOptions setConcurrency(Concurrency mode)
+  {
+    concurrency = mode.ordinal();
+    strandKey = 0;
+    return this;
+  }
+
+  /**
+   * Serialize calls having the same value of a key argument, run others in parallel.
+   * @see setConcurrency
+   * @param keyArgument Index of the key argument in method parameters
+   * @return this, to chain settings
+   */
+  public MethodOptions setStrand(int keyArgument)
+  {
+    concurrency = Concurrency.Strand.ordinal();
+    strandKey = keyArgument;
+    return this;
+  }
+
+  /**
+   * Fail calls that are not finished after given time.
+   * Time spent waiting for a thread counts. Once the deadline is
+   * exceeded, the caller gets an error and the implementation sees
+   * QiContext.isCancelled() return true, so that it can stop early.
+   * A method with a deadline never runs in the thread that received the call.
+   * @see QiContext
+   * @param timeoutMs Deadline in milliseconds after reception of a call, 0 for no deadline
+   * @return this, to chain settings
+   */
+  public MethodOptions setDeadline(long timeoutMs)
+  {
+    deadlineMs = timeoutMs;
+    return this;
+  }
+
+  /**
+   * Deliver calls of this method in batches, for methods called faster than
+   * they can be handled one by one.
+   * Calls received while a batch is delivered are queued natively, then
+   * given together to handler, a method of the service taking the
+   * arguments of each call:
+   * <pre>
+   * public Object[] handler(Object[][] calls)
+   * public void handler(Object[][] calls)
+   * </pre>
+   * Result i of the returned array completes call i. A handler returning
+   * void completes all calls, an exception fails them all.
+   * @param handler Name of the batch handler
+   * @param maxBatchSize Maximum number of calls given at once, 0 for no limit
+   * @return this, to chain settings
+   */
+  public MethodOptions setBatching(String handler, int maxBatchSize)
+  {
+    this.batchHandler = handler;
+    this.maxBatchSize = maxBatchSize;
+    return this;
+  }
+
+  boolean isBatched()
+  {
+    return batchHandler != null;
+  }
+}
@@ -0,0 +1,20 @@
+/*
+**  Copyright (C) 2015 Aldebaran Robotics
+**  See COPYING for the license
+*/
+package com.aldebaran.qi;
+
+/**
+ * What happens to a call made while call limits are reached.
+ * @see AnyObject#setCallLimits
+ * @see Session#setCallLimits
+ */
+public enum OverflowPolicy
+{
+  /// call() waits until a call in flight finishes
+  Block,
+  /// The new call fails immediately
+  FailFast,
+  /// Oldest calls in flight fail to make room for the new one
+  DropOldest
+}
@@ -0,0 +1,123 @@
+/*
+**  Copyright (C) 2015 Aldebaran Robotics
+**  See COPYING for the license
+*/
+package com.aldebaran.qi;
+
+/**
+ * Chain of remote calls run natively, one after the other.
+ * A step may be made on, or take as argument, the result of an earlier step:
+ * intermediate results are never converted to Java objects, only the result
+ * of the last step is.
+ * <pre>
+ * Pipeline p = new Pipeline();
+ * Pipeline.Result handle = p.call(serviceA, "getHandle");
+ * Pipeline.Result obj = p.call(serviceB, "open", handle);
+ * p.property(obj, "state");
+ * Future&lt;String&gt; state = p.&lt;String&gt;run();
+ * </pre>
+ */
+public class Pipeline
+{
+
+  // Loading QiMessaging JNI layer
+  static
+  {
+    if (!EmbeddedTools.LOADED_EMBEDDED_LIBRARY)
+    {
+      EmbeddedTools loader = new EmbeddedTools();
+      loader.loadEmbeddedLibraries();
+    }
+  }
+
+  /**
+   * Placeholder for the result of a step, usable as target or argument of later steps.
+   */
+  public static class Result
+  {
+    // Read by native code
+    private final int step;
+
+    private Result(int step)
+    {
+      this.step = step;
+    }
+  }
+
+  // C++ pipeline
+  private long _p;
+
+  private static native long create();
+  private static native void destroy(long pPipeline);
+  private static native int  addCall(long pPipeline, AnyObject object, int target, String method, Object[] args);
+  private static native int  addProperty(long pPipeline, AnyObject object, int target, String name);
+  private static native long run(long pPipeline);
+
+  public Pipeline()
+  {
+    _p = Pipeline.create();
+  }
+
+  /**
+   * Add a call to a method of object.
+   * @param object Object to call
+   * @param method Method name to call
+   * @param args Arguments, Result of an earlier step are replaced by its value
+   * @return Result of this step
+   */
+  public Result call(AnyObject object, String method, Object ... args)
+  {
+    return new Result(Pipeline.addCall(_p, object, -1, method, args));
+  }
+
+  /**
+   * Add a call to a method of the object returned by an earlier step.
+   * @param target Step returning an object
+   * @param method Method name to call
+   * @param args Arguments, Result of an earlier step are replaced by its value
+   * @return Result of this step
+   */
+  public Result call(Result target, String method, Object ... args)
+  {
+    return new Result(Pipeline.addCall(_p, null, target.step, method, args));
+  }
+
+  /**
+   * Add a read of a property of object.
+   * @return Result of this step
+   */
+  public Result property(AnyObject object, String name)
+  {
+    return new Result(Pipeline.addProperty(_p, object, -1, name));
+  }
+
+  /**
+   * Add a read of a property of the object returned by an earlier step.
+   * @return Result of this step
+   */
+  public Result property(Result target, String name)
+  {
+    return new Result(Pipeline.addProperty(_p, null, target.step, name));
+  }
+
+  /**
+   * Run all steps in order. A failing step stops the pipeline.
+   * A pipeline can be run several times.
+   * @return Future of the last step result
+   */
+  public <T> Future<T> run()
+  {
+    return new Future<T>(Pipeline.run(_p));
+  }
+
+  /**
+   * Called by garbage collector
+   * Finalize is overriden to manually delete C++ data
+   */
+  @Override
+  protected void finalize() throws Throwable
+  {
+    Pipeline.destroy(_p);
+    super.finalize();
+  }
+}
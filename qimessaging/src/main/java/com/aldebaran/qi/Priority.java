@@ -0,0 +1,42 @@
+/*
+**  Copyright (C) 2015 Aldebaran Robotics
+**  See COPYING for the license
+*/
+package com.aldebaran.qi;
+
+/**
+ * Priority of callbacks dispatched to Java.
+ * Prioritized callbacks (signal subscribers, future callbacks) are queued
+ * in one lane per priority and run by a shared pool of native threads,
+ * which always takes the first callback of the highest priority lane.
+ * Callbacks registered without priority run directly in qimessaging threads.
+ */
+public enum Priority
+{
+  /// Control loops, latency sensitive callbacks
+  High,
+  /// Default lane
+  Normal,
+  /// Bulk transfers, background work
+  Low;
+
+  // Loading QiMessaging JNI layer
+  static
+  {
+    if (!EmbeddedTools.LOADED_EMBEDDED_LIBRARY)
+    {
+      EmbeddedTools loader = new EmbeddedTools();
+      loader.loadEmbeddedLibraries();
+    }
+  }
+
+  private static native int queueDepth(int lane);
+
+  /**
+   * @return Number of callbacks of this priority waiting for a thread.
+   */
+  public int queueDepth()
+  {
+    return Priority.queueDepth(ordinal());
+  }
+}
@@ -0,0 +1,80 @@
+/*
+**  Copyright (C) 2015 Aldebaran Robotics
+**  See COPYING for the license
+*/
+package com.aldebaran.qi;
+
+/**
+ * Producer side of a com.aldebaran.qi.Future.
+ * A service method advertised with DynamicObjectBuilder can return
+ * promise.getFuture() and set the value later from any thread:
+ * the call completes when the promise is set.
+ *
+ * @param <T> Type of the value
+ */
+public class Promise <T>
+{
+
+  // Loading QiMessaging JNI layer
+  static
+  {
+    if (!EmbeddedTools.LOADED_EMBEDDED_LIBRARY)
+    {
+      EmbeddedTools loader = new EmbeddedTools();
+      loader.loadEmbeddedLibraries();
+    }
+  }
+
+  // C++ Promise
+  private long _promise;
+
+  // Native C API object functions
+  private static native long qiPromiseCreate();
+  private static native void qiPromiseDestroy(long pPromise);
+  private static native long qiPromiseGetFuture(long pPromise);
+  private static native void qiPromiseSetValue(long pPromise, Object value);
+  private static native void qiPromiseSetError(long pPromise, String error);
+
+  public Promise()
+  {
+    _promise = Promise.qiPromiseCreate();
+  }
+
+  /**
+   * @return Future completed when this promise is set.
+   */
+  public Future<T> getFuture()
+  {
+    return new Future<T>(Promise.qiPromiseGetFuture(_promise));
+  }
+
+  /**
+   * Complete the future with a value.
+   * @param value Value of the future
+   */
+  public void setValue(T value)
+  {
+    Promise.qiPromiseSetValue(_promise, value);
+  }
+
+  /**
+   * Complete the future with an error.
+   * @param errorMessage Error of the future
+   */
+  public void setError(String errorMessage)
+  {
+    Promise.qiPromiseSetError(_promise, errorMessage);
+  }
+
+  /**
+   * Called by garbage collector
+   * Finalize is overriden to manually delete C++ data
+   */
+  @Override
+  protected void finalize() throws Throwable
+  {
+    Promise.qiPromiseDestroy(_promise);
+    super.finalize();
+  }
+
+}
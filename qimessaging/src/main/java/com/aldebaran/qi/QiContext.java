@@ -0,0 +1,41 @@
+/*
+**  Copyright (C) 2015 Aldebaran Robotics
+**  See COPYING for the license
+*/
+package com.aldebaran.qi;
+
+/**
+ * State of the service method invocation running in current thread.
+ * @see MethodOptions#setCancellable
+ */
+public final class QiContext
+{
+
+  // Loading QiMessaging JNI layer
+  static
+  {
+    if (!EmbeddedTools.LOADED_EMBEDDED_LIBRARY)
+    {
+      EmbeddedTools loader = new EmbeddedTools();
+      loader.loadEmbeddedLibraries();
+    }
+  }
+
+  private static native boolean cancelRequested();
+
+  private QiContext()
+  {
+  }
+
+  /**
+   * Long running implementations of cancellable methods should poll this
+   * and return early when it becomes true: the caller canceled the call,
+   * or gave up waiting for it, and the result will be dropped.
+   * @return true if cancellation of the current invocation was requested.
+   * Always false outside of a cancellable method.
+   */
+  public static boolean isCancelled()
+  {
+    return QiContext.cancelRequested();
+  }
+}
@@ -0,0 +1,20 @@
+/*
+**  Copyright (C) 2015 Aldebaran Robotics
+**  See COPYING for the license
+*/
+package com.aldebaran.qi;
+
+@SuppressWarnings("serial")
+public class RemoteError extends CallError
+{
+
+  /**
+   * Exception thrown when a remote method failed, or threw an exception.
+   * @param e Error message.
+   */
+  public RemoteError(String e)
+  {
+    super(e);
+  }
+
+}
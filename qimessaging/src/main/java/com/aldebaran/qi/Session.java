@@ -27,6 +27,8 @@ public class Session
   private static native int     registerService(long pSession, String name, AnyObject obj);
   private static native void    unregisterService(long pSession, int idx);
   private static native void    onDisconnected(long pSession, String callback, Object obj);
+  private static native void    setCallLimits(long pSession, int maxInFlight, long maxBytes, int overflow);
+  private static native long[]  callCounters(long pSession);
 
   // Members
   private long _session;
@@ -92,6 +94,28 @@ public class Session
     return (AnyObject) Session.service(_session, name);
   }
 
+  /**
+   * Bound calls in flight through all proxies given by this session.
+   * Only applies to proxies returned by service() after this call.
+   * @see AnyObject#setCallLimits
+   * @param maxInFlight Maximum number of calls not finished yet, 0 for no limit
+   * @param maxBytes Maximum size of the arguments of calls in flight, 0 for no limit
+   * @param overflow What to do with a call beyond limits
+   * @throws Exception If a limit is negative
+   */
+  public void setCallLimits(int maxInFlight, long maxBytes, OverflowPolicy overflow) throws Exception
+  {
+    Session.setCallLimits(_session, maxInFlight, maxBytes, overflow.ordinal());
+  }
+
+  /**
+   * @return Counters of the calls limited by setCallLimits
+   */
+  public CallCounters callCounters()
+  {
+    return new CallCounters(Session.callCounters(_session));
+  }
+
   /**
    * Close connection to Service Directory
    */
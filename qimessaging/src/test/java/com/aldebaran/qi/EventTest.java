@@ -6,6 +6,13 @@ package com.aldebaran.qi;
 
 import static org.junit.Assert.*;
 
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.Collections;
+import java.util.List;
+import java.util.concurrent.CountDownLatch;
+import java.util.concurrent.TimeUnit;
+
 import org.junit.After;
 import org.junit.Before;
 import org.junit.Test;
@@ -110,6 +117,190 @@ public class EventTest
     assertTrue("Event callback not called ", ! callbackCalled);
   }
 
+  @Test
+  public void testSharedSubscription() throws Exception
+  {
+    final int[] calls = new int[2];
+
+    @SuppressWarnings("unused")
+    Object first = new Object() {
+      public void fireCallback(Integer i)
+      {
+        calls[0] += i.intValue();
+      }
+    };
+    @SuppressWarnings("unused")
+    Object second = new Object() {
+      public void fireCallback(Integer i)
+      {
+        calls[1] += i.intValue();
+      }
+    };
+
+    long firstId = proxy.connect("fire::(i)", "fireCallback::(i)", first);
+    long secondId = proxy.connect("fire::(i)", "fireCallback::(i)", second);
+    assertTrue("Subscriber ids must differ", firstId != secondId);
+
+    obj.post("fire", 1);
+    Thread.sleep(100);
+    assertEquals(1, calls[0]);
+    assertEquals(1, calls[1]);
+
+    // Remaining listener keeps the subscription alive.
+    proxy.disconnect(firstId);
+    obj.post("fire", 1);
+    Thread.sleep(100);
+    assertEquals(1, calls[0]);
+    assertEquals(2, calls[1]);
+
+    proxy.disconnect(secondId);
+    obj.post("fire", 1);
+    Thread.sleep(100);
+    assertEquals(2, calls[1]);
+
+    // Subscription is created again for a new listener.
+    secondId = proxy.connect("fire::(i)", "fireCallback::(i)", second);
+    obj.post("fire", 1);
+    Thread.sleep(100);
+    assertEquals(3, calls[1]);
+    proxy.disconnect(secondId);
+
+    // Another proxy to the same service joins the subscription, and keeps it once the first leaves.
+    AnyObject other = client.service("serviceTest");
+    firstId = proxy.connect("fire::(i)", "fireCallback::(i)", first);
+    secondId = other.connect("fire::(i)", "fireCallback::(i)", second);
+    obj.post("fire", 1);
+    Thread.sleep(100);
+    assertEquals(2, calls[0]);
+    assertEquals(4, calls[1]);
+
+    proxy.disconnect(firstId);
+    obj.post("fire", 1);
+    Thread.sleep(100);
+    assertEquals(2, calls[0]);
+    assertEquals(5, calls[1]);
+    other.disconnect(secondId);
+  }
+
+  @Test
+  public void testListenerOutlivesProxy() throws Exception
+  {
+    final int[] calls = new int[1];
+
+    @SuppressWarnings("unused")
+    Object callback = new Object() {
+      public void fireCallback(Integer i)
+      {
+        calls[0] += i.intValue();
+      }
+    };
+
+    // The proxy is not kept: the subscription lives until disconnect().
+    long id = client.service("serviceTest").connect("fire::(i)", "fireCallback::(i)", callback);
+    System.gc();
+    System.runFinalization();
+    obj.post("fire", 1);
+    Thread.sleep(100);
+    assertEquals(1, calls[0]);
+
+    proxy.disconnect(id);
+    obj.post("fire", 1);
+    Thread.sleep(100);
+    assertEquals(1, calls[0]);
+  }
+
+  @Test
+  public void testPriorityOrder() throws Exception
+  {
+    DynamicObjectBuilder ob = new DynamicObjectBuilder();
+    ob.advertiseSignal("block::(i)");
+    ob.advertiseSignal("fire::(i)");
+    AnyObject o = ob.object();
+
+    final CountDownLatch blocked = new CountDownLatch(2);
+    final CountDownLatch[] release = { new CountDownLatch(1), new CountDownLatch(1) };
+    final List<String> order = Collections.synchronizedList(new ArrayList<String>());
+
+    @SuppressWarnings("unused")
+    Object first = new Object() {
+      public void blockCallback(Integer i) throws InterruptedException
+      {
+        blocked.countDown();
+        release[0].await();
+      }
+    };
+    @SuppressWarnings("unused")
+    Object second = new Object() {
+      public void blockCallback(Integer i) throws InterruptedException
+      {
+        blocked.countDown();
+        release[1].await();
+      }
+    };
+    @SuppressWarnings("unused")
+    Object high = new Object() {
+      public void fireCallback(Integer i)
+      {
+        order.add("high" + i);
+      }
+    };
+    @SuppressWarnings("unused")
+    Object low = new Object() {
+      public void fireCallback(Integer i)
+      {
+        order.add("low" + i);
+      }
+    };
+
+    // Both dispatcher threads are held by subscriptions of two lanes.
+    o.connect("block::(i)", "blockCallback::(i)", first, Priority.Low);
+    o.connect("block::(i)", "blockCallback::(i)", second, Priority.Normal);
+    o.post("block", 0);
+    assertTrue(blocked.await(5, TimeUnit.SECONDS));
+
+    o.connect("fire::(i)", "fireCallback::(i)", low, Priority.Low);
+    o.connect("fire::(i)", "fireCallback::(i)", high, Priority.High);
+    o.post("fire", 1);
+    o.post("fire", 2);
+    Thread.sleep(100);
+    // One delivery task per subscription is queued at a time.
+    assertEquals(1, Priority.High.queueDepth());
+
+    // A single thread is released: high priority events first, each subscriber in emission order.
+    release[0].countDown();
+    long end = System.currentTimeMillis() + 5000;
+    while (order.size() < 4 && System.currentTimeMillis() < end)
+      Thread.sleep(10);
+    assertEquals(Arrays.asList("high1", "high2", "low1", "low2"), order);
+    release[1].countDown();
+  }
+
+  @Test
+  public void testSubscriberOrder() throws Exception
+  {
+    final int count = 200;
+    final List<Integer> received = Collections.synchronizedList(new ArrayList<Integer>());
+    final CountDownLatch done = new CountDownLatch(count);
+
+    @SuppressWarnings("unused")
+    Object callback = new Object() {
+      public void fireCallback(Integer i)
+      {
+        received.add(i);
+        done.countDown();
+      }
+    };
+
+    // Events of one subscriber never overlap nor overtake each other, whatever the number of dispatcher threads.
+    long sid = obj.connect("fire::(i)", "fireCallback::(i)", callback, Priority.Normal);
+    for (int i = 0; i < count; ++i)
+      obj.post("fire", i);
+    assertTrue(done.await(5, TimeUnit.SECONDS));
+    for (int i = 0; i < count; ++i)
+      assertEquals(new Integer(i), received.get(i));
+    obj.disconnect(sid);
+  }
+
   public void testCallback(String s)
   {
     callbackCalled = true;
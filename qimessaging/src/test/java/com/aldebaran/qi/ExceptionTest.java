@@ -49,6 +49,7 @@ public class ExceptionTest {
     ob.advertiseMethod("echoFloatList::[m]([f])", reply, "Return the exact same list");
     ob.advertiseMethod("createObject::o()", reply, "Return a test object");
     ob.advertiseMethod("iWillThrow::b()", reply, "Throw.");
+    ob.advertiseMethod("throwMessage::b(s)", reply, "Throw with given message.");
 
     // Connect session to Service Directory
     s.connect(url).sync();
@@ -92,4 +93,23 @@ public class ExceptionTest {
     assertTrue(exceptionThrown);
   }
 
+  @Test
+  public void typedErrors() throws Exception
+  {
+    try {
+      proxy.<Boolean>call("iWillThrow").get();
+      fail("Call must fail");
+    } catch (RemoteError e) {
+      // Java exception class and message are carried to the caller
+      assertTrue(e.getMessage().contains("java.lang.Exception: Expected Failure"));
+    }
+
+    // A service message mentioning a conversion is still a remote error
+    try {
+      proxy.<Boolean>call("throwMessage", "Conversion failed: cannot convert parameters from (i) to (s)").get();
+      fail("Call must fail");
+    } catch (RemoteError e) {
+    }
+  }
+
 }
@@ -4,6 +4,9 @@
 */
 package com.aldebaran.qi;
 
+import java.util.List;
+import java.util.concurrent.CountDownLatch;
+import java.util.concurrent.ExecutionException;
 import java.util.concurrent.TimeUnit;
 import java.util.concurrent.TimeoutException;
 
@@ -63,6 +66,8 @@ public class FutureTest
     ob.advertiseMethod("echoFloatList::[m]([f])", reply, "Return the exact same list");
     ob.advertiseMethod("createObject::o()", reply, "Return a test object");
     ob.advertiseMethod("longReply::s(s)", reply, "Sleep 2s, then return given argument + 'bim !'");
+    ob.advertiseMethod("asyncReply::s(s)", reply, "Return a future on given argument + 'bim !'");
+    ob.advertiseMethod("iWillThrow::b()", reply, "Throw.");
 
     // Connect session to Service Directory
     s.connect(url).sync();
@@ -148,6 +153,76 @@ public class FutureTest
     assertTrue(onCompleteCalled);
   }
 
+  @Test
+  public void testPriorityCallback() throws Exception
+  {
+    final CountDownLatch done = new CountDownLatch(1);
+    Future<String> fut = proxy.call(Priority.High, "reply", "plaf");
+    fut.addCallback(new Callback<String>() {
+
+      public void onSuccess(Future<String> future, Object[] args)
+      {
+        done.countDown();
+      }
+
+      public void onFailure(Future<String> future, Object[] args)
+      {
+        fail("onFailure must not be called");
+      }
+
+      public void onComplete(Future<String> future, Object[] args)
+      {
+      }
+    });
+
+    assertTrue(done.await(5, TimeUnit.SECONDS));
+    assertEquals(0, Priority.High.queueDepth());
+  }
+
+  @Test
+  public void testManyCallbacks() throws Exception
+  {
+    final int count = 1000;
+    final CountDownLatch done = new CountDownLatch(count);
+    Callback<String> callback = new Callback<String>() {
+
+      public void onSuccess(Future<String> future, Object[] args)
+      {
+        try {
+          assertEquals("plafbim !", future.get());
+        } catch (Exception e) {
+          fail("Future given to onSuccess must hold the value");
+        }
+        done.countDown();
+      }
+
+      public void onFailure(Future<String> future, Object[] args)
+      {
+        fail("onFailure must not be called");
+      }
+
+      public void onComplete(Future<String> future, Object[] args)
+      {
+      }
+    };
+
+    // Each callback is bound to its own future, in any completion order.
+    for (int i = 0; i < count; ++i)
+      proxy.<String>call("reply", "plaf").addCallback(callback);
+    assertTrue(done.await(30, TimeUnit.SECONDS));
+  }
+
+  @Test
+  public void testAsyncMethod() throws Exception
+  {
+    Future<String> fut = proxy.call("asyncReply", "plaf");
+    assertEquals("plafbim !", fut.get());
+
+    // Same call from this session, without going through the network
+    AnyObject local = s.service("serviceTest");
+    assertEquals("plafbim !", local.<String>call("asyncReply", "plaf").get());
+  }
+
   @Test
   public void testLongCall()
   {
@@ -276,6 +351,254 @@ public class FutureTest
     assertEquals("plafbim !", fut.get());
   }
 
+  @Test
+  public void testCombinators() throws Exception
+  {
+    Future<String> slow = proxy.call("longReply", "slow");
+    Future<String> fast = proxy.call("reply", "fast");
+    Future<?>[] futures = new Future<?>[] { slow, fast };
+
+    assertEquals(1, Future.waitAny(futures, 1, TimeUnit.SECONDS));
+    assertFalse(Future.waitAll(futures, 100, TimeUnit.MILLISECONDS));
+    assertEquals(Integer.valueOf(1), Future.whenAny(slow, fast).get());
+
+    List<Object> values = Future.whenAll(slow, fast).get();
+    assertTrue(Future.waitAll(futures, 0, TimeUnit.MILLISECONDS));
+    assertEquals(2, values.size());
+    assertEquals("slowbim !", values.get(0));
+    assertEquals("fastbim !", values.get(1));
+
+    Future<Boolean> failing = proxy.call("iWillThrow");
+    try
+    {
+      Future.whenAll(fast, failing).get();
+      fail("whenAll must fail if one of its futures fails");
+    } catch (CallError e)
+    {
+    }
+
+    // The first error is reported without waiting for other futures.
+    Promise<String> never = new Promise<String>();
+    try
+    {
+      Future.whenAll(never.getFuture(), failing).get(10, TimeUnit.SECONDS);
+      fail("whenAll must fail if one of its futures fails");
+    } catch (ExecutionException e)
+    {
+    }
+    never.setValue("done");
+
+    // Timeouts beyond int milliseconds do not wrap around.
+    assertTrue(Future.waitAll(futures, Long.MAX_VALUE, TimeUnit.MILLISECONDS));
+  }
+
+  @Test
+  public void testContinuations() throws Exception
+  {
+    Future<String> fut = proxy.call("reply", "plaf");
+
+    Future<Integer> length = fut.andThen(new Function<String, Integer>()
+    {
+      public Integer execute(String value)
+      {
+        return value.length();
+      }
+    });
+    assertEquals(Integer.valueOf(9), length.get());
+
+    Future<Boolean> failed = proxy.<Boolean>call("iWillThrow").then(new Function<Future<Boolean>, Boolean>()
+    {
+      public Boolean execute(Future<Boolean> future)
+      {
+        return !future.isCancelled() && future.isDone();
+      }
+    });
+    assertTrue(failed.get());
+
+    Future<Integer> skipped = proxy.<Boolean>call("iWillThrow").andThen(new Function<Boolean, Integer>()
+    {
+      public Integer execute(Boolean value)
+      {
+        return 0;
+      }
+    });
+    try
+    {
+      skipped.get();
+      fail("andThen must forward errors");
+    } catch (CallError e)
+    {
+    }
+
+    java.util.concurrent.Future<String> adapter = proxy.<String>call("reply", "plouf").toJavaFuture();
+    assertEquals("ploufbim !", adapter.get(1, TimeUnit.SECONDS));
+    assertTrue(adapter.isDone());
+
+    adapter = proxy.<String>call("iWillThrow").toJavaFuture();
+    try
+    {
+      adapter.get();
+      fail("Adapter must fail as its future");
+    } catch (ExecutionException e)
+    {
+      assertTrue(e.getCause() instanceof CallError);
+    }
+  }
+
+  @Test
+  public void testConvertOnce() throws Exception
+  {
+    Future<String> fut = proxy.call("reply", "plaf");
+    String value = fut.get();
+    assertSame("Value must be converted once", value, fut.get());
+    assertSame(value, fut.get(1, TimeUnit.SECONDS));
+
+    // get() waits for the eager conversion, even if sync() returned before it.
+    Future<String> eager = proxy.<String>call("reply", "plouf").convertEagerly();
+    eager.sync();
+    String eagerValue = eager.get();
+    assertEquals("ploufbim !", eagerValue);
+    assertSame(eagerValue, eager.get());
+    assertSame(eagerValue, eager.get(1, TimeUnit.SECONDS));
+  }
+
+  @Test
+  public void testClose() throws Exception
+  {
+    Future<String> fut = proxy.call("reply", "plaf");
+    Future<String> other = proxy.call("reply", "plouf");
+    assertEquals("plafbim !", fut.get());
+    assertTrue(fut.isValid());
+
+    fut.close();
+    assertFalse(fut.isValid());
+    try
+    {
+      fut.get();
+      fail("A closed future cannot be used");
+    } catch (CallError e)
+    {
+    }
+    try
+    {
+      fut.get(1, TimeUnit.SECONDS);
+      fail("A closed future cannot be used");
+    } catch (ExecutionException e)
+    {
+    }
+    // Closing twice, and finalizing a closed future, is harmless.
+    fut.close();
+
+    // A stale handle does not reach a future reusing its slot.
+    Future<String> next = proxy.call("reply", "plof");
+    assertFalse(fut.isValid());
+    assertEquals("plofbim !", next.get());
+    assertEquals("ploufbim !", other.get());
+  }
+
+  @Test
+  public void testCompletionQueue() throws Exception
+  {
+    CompletionQueue queue = new CompletionQueue();
+    long[] tags = new long[16];
+
+    assertEquals(0, queue.drain(tags, tags.length, 0, TimeUnit.SECONDS));
+    for (int i = 0; i < 10; ++i)
+      queue.add(proxy.call("answer", i), i);
+
+    int received = 0;
+    boolean[] seen = new boolean[10];
+    while (received < 10)
+    {
+      int count = queue.drain(tags, 4, 1, TimeUnit.SECONDS);
+      assertTrue("Futures must finish", count > 0);
+      assertTrue(count <= 4);
+      for (int i = 0; i < count; ++i)
+      {
+        int tag = (int) tags[i];
+        assertFalse(seen[tag]);
+        seen[tag] = true;
+        assertEquals(Integer.valueOf(tag + 1), queue.<Integer>take(tag).get());
+        assertNull("A future is taken once", queue.take(tag));
+      }
+      received += count;
+    }
+
+    // A tag is reused once its future is taken only.
+    queue.add(proxy.call("answer", 41), 0);
+    try
+    {
+      queue.add(proxy.call("answer", 42), 0);
+      fail("A tag in use must be refused");
+    } catch (Exception e)
+    {
+    }
+    assertEquals(1, queue.drain(tags, tags.length, 1, TimeUnit.SECONDS));
+    assertEquals(Integer.valueOf(42), queue.<Integer>take(0).get());
+    queue.add(proxy.call("answer", 42), 0);
+    assertEquals(1, queue.drain(tags, tags.length, 1, TimeUnit.SECONDS));
+    assertEquals(Integer.valueOf(43), queue.<Integer>take(0).get());
+    queue.close();
+
+    // Closing wakes up a thread waiting in drain, the queue cannot be used anymore.
+    final CompletionQueue waiting = new CompletionQueue();
+    Thread drainer = new Thread(new Runnable()
+    {
+      public void run()
+      {
+        try
+        {
+          waiting.drain(new long[4], 4);
+        } catch (Exception e)
+        {
+          // Closed before drain started
+        }
+      }
+    });
+    drainer.start();
+    Thread.sleep(50);
+    waiting.close();
+    drainer.join(5000);
+    assertFalse(drainer.isAlive());
+    try
+    {
+      waiting.drain(tags, tags.length, 0, TimeUnit.SECONDS);
+      fail("A closed queue cannot be used");
+    } catch (Exception e)
+    {
+    }
+    waiting.close();
+  }
+
+  @Test
+  public void testManagedWait() throws Exception
+  {
+    assertEquals("plafbim !", proxy.<String>call("reply", "plaf").setManagedWait(true).get());
+
+    Future<String> slow = proxy.<String>call("longReply", "plouf").setManagedWait(true);
+    try
+    {
+      slow.get(100, TimeUnit.MILLISECONDS);
+      fail("Call must not be finished yet");
+    } catch (TimeoutException e)
+    {
+    }
+    slow.sync();
+    assertTrue(slow.isDone());
+    assertEquals("ploufbim !", slow.get());
+
+    try
+    {
+      proxy.<Boolean>call("iWillThrow").setManagedWait(true).get();
+      fail("Error must be thrown by get()");
+    } catch (CallError e)
+    {
+    }
+
+    // Other futures still wait in native code.
+    assertEquals("plofbim !", proxy.<String>call("reply", "plof").get());
+  }
+
   @Test
   public void testSessionTimeout()
   {
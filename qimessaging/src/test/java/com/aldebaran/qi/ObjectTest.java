@@ -6,6 +6,8 @@ package com.aldebaran.qi;
 
 import static org.junit.Assert.*;
 
+import java.util.ArrayList;
+
 import org.junit.After;
 import org.junit.Before;
 import org.junit.Test;
@@ -41,18 +43,23 @@ public class ObjectTest
     ob.advertiseMethod("reply::s(s)", reply, "Concatenate given argument with 'bim !'");
     ob.advertiseMethod("answer::s()", reply, "Return given argument");
     ob.advertiseMethod("add::i(iii)", reply, "Return sum of arguments");
+    ob.advertiseMethod("addPrimitive::i(ii)", reply, "Return sum of arguments, without boxing");
+    ob.advertiseMethod("waitForCancel::b(i)", reply, "Wait until call is canceled",
+                       new MethodOptions().setCancellable(true));
     ob.advertiseMethod("info::(sib)(sib)", reply, "Return a tuple containing given arguments");
     ob.advertiseMethod("answer::i(i)", reply, "Return given parameter plus 1");
     ob.advertiseMethod("answerFloat::f(f)", reply, "Return given parameter plus 1");
     ob.advertiseMethod("answerBool::b(b)", reply, "Flip given parameter and return it");
     ob.advertiseMethod("abacus::{ib}({ib})", reply, "Flip all booleans in map");
     ob.advertiseMethod("echoFloatList::[m]([f])", reply, "Return the exact same list");
+    ob.advertiseMethod("echo::m(m)", reply, "Return given value");
     ob.advertiseMethod("createObject::o()", reply, "Return a test object");
     ob.advertiseMethod("setStored::v(i)", reply, "Set stored value");
     ob.advertiseMethod("waitAndAddToStored::i(ii)", reply, "Wait given time, and return stored + val");
 
     QiService replyts = new ReplyService();
     DynamicObjectBuilder obts = new DynamicObjectBuilder();
+    obts.advertiseSignal("fire::(i)");
     obts.advertiseMethod("setStored::v(i)", replyts, "Set stored value");
     obts.advertiseMethod("waitAndAddToStored::i(ii)", replyts, "Wait given time, and return stored + val");
     obts.setThreadingModel(DynamicObjectBuilder.ObjectThreadingModel.MultiThread);
@@ -108,6 +115,399 @@ public class ObjectTest
     assertEquals(v0.get(), new Integer(42));
   }
 
+  @Test
+  public void executor() throws Exception
+  {
+    QiService reply = new ReplyService();
+    DynamicObjectBuilder ob = new DynamicObjectBuilder();
+    ob.advertiseMethod("reply::s(s)", reply, "Concatenate given argument with 'bim !'");
+    ob.advertiseMethod("waitAndAddToStored::i(ii)", reply, "Wait given time, and return stored + val");
+    ob.setExecutor(2, 0);
+    assertTrue("Service must be registered", s.registerService("serviceTestExecutor", ob.object()) > 0);
+
+    AnyObject proxyex = client.service("serviceTestExecutor");
+    Future<Integer> v0 = proxyex.<Integer>call("waitAndAddToStored", 200, 1);
+    assertEquals("plafbim !", proxyex.<String>call("reply", "plaf").get());
+    assertEquals(new Integer(1), v0.get());
+  }
+
+  @Test
+  public void admissionLimits() throws Exception
+  {
+    QiService reply = new ReplyService();
+    DynamicObjectBuilder ob = new DynamicObjectBuilder();
+    ob.advertiseMethod("waitAndAddToStored::i(ii)", reply, "Wait given time, and return stored + val");
+    ob.setThreadingModel(DynamicObjectBuilder.ObjectThreadingModel.MultiThread);
+    ob.setAdmissionLimits(1, 1, 0);
+    assertTrue("Service must be registered", s.registerService("serviceTestAdmission", ob.object()) > 0);
+
+    AnyObject proxyad = client.service("serviceTestAdmission");
+    Future<Integer> v0 = proxyad.<Integer>call("waitAndAddToStored", 300, 1);
+    Thread.sleep(50);
+    Future<Integer> v1 = proxyad.<Integer>call("waitAndAddToStored", 0, 2);
+    Thread.sleep(50);
+    // One call running, one queued: no room left.
+    try {
+      proxyad.<Integer>call("waitAndAddToStored", 0, 3).get();
+      fail("Call beyond admission limits must fail");
+    } catch (CallError e) {
+      assertTrue(e.getMessage().contains("Service overloaded"));
+    }
+    assertEquals(new Integer(1), v0.get());
+    assertEquals(new Integer(2), v1.get());
+
+    // A method returning a Future keeps its room until that future completes.
+    ob = new DynamicObjectBuilder();
+    ob.advertiseMethod("asyncReply::s(s)", reply, "Return a future on given argument + 'bim !'");
+    ob.setAdmissionLimits(1, 1, 0);
+    assertTrue("Service must be registered", s.registerService("serviceTestAdmissionAsync", ob.object()) > 0);
+
+    proxyad = client.service("serviceTestAdmissionAsync");
+    Future<String> r0 = proxyad.<String>call("asyncReply", "plaf");
+    Thread.sleep(50);
+    Future<String> r1 = proxyad.<String>call("asyncReply", "plouf");
+    Thread.sleep(50);
+    try {
+      proxyad.<String>call("asyncReply", "plif").get();
+      fail("Call beyond admission limits must fail");
+    } catch (CallError e) {
+      assertTrue(e.getMessage().contains("Service overloaded"));
+    }
+    assertEquals("plafbim !", r0.get());
+    assertEquals("ploufbim !", r1.get());
+  }
+
+  @Test
+  public void callCollapsing() throws Exception
+  {
+    proxyts.setCallCollapsing("waitAndAddToStored", true);
+    Future<Integer> v0 = proxyts.<Integer>call("waitAndAddToStored", 500, 1);
+    Thread.sleep(10);
+    proxyts.<Void>call("setStored", 42).get();
+    // Identical call in flight: shares v0 result instead of reading new stored value.
+    Future<Integer> v1 = proxyts.<Integer>call("waitAndAddToStored", 500, 1);
+    assertEquals(new Integer(1), v0.get());
+    assertEquals(new Integer(1), v1.get());
+
+    proxyts.setCallCollapsing("waitAndAddToStored", false);
+    assertEquals(new Integer(43), proxyts.<Integer>call("waitAndAddToStored", 0, 1).get());
+  }
+
+  @Test
+  public void callCache() throws Exception
+  {
+    proxyts.setCallCache("waitAndAddToStored", 60000, 4096);
+    proxyts.setCacheInvalidationSignal("fire");
+    assertEquals(new Integer(1), proxyts.<Integer>call("waitAndAddToStored", 0, 1).get());
+    proxyts.<Void>call("setStored", 42).get();
+    Future<Integer> cached = proxyts.<Integer>call("waitAndAddToStored", 0, 1);
+    assertTrue(cached.isDone());
+    assertEquals(new Integer(1), cached.get());
+    assertEquals(new Integer(44), proxyts.<Integer>call("waitAndAddToStored", 0, 2).get());
+
+    objts.post("fire", 42);
+    Thread.sleep(100);
+    assertEquals(new Integer(43), proxyts.<Integer>call("waitAndAddToStored", 0, 1).get());
+
+    // Result of a call in flight during invalidation is not cached.
+    Future<Integer> stale = proxyts.<Integer>call("waitAndAddToStored", 300, 5);
+    Thread.sleep(50);
+    proxyts.<Void>call("setStored", 0).get();
+    objts.post("fire", 42);
+    assertEquals(new Integer(47), stale.get());
+    assertEquals(new Integer(5), proxyts.<Integer>call("waitAndAddToStored", 0, 5).get());
+
+    // Cached Java objects are not shared between callers.
+    AnyObject local = s.service("serviceTest");
+    local.setCallCache("echo", 60000, 4096);
+    ArrayList<Integer> list = new ArrayList<Integer>();
+    list.add(42);
+    local.<Object>call("echo", list).get();
+    Object cachedList = local.<Object>call("echo", list).get();
+    assertEquals(list, cachedList);
+    assertNotSame(list, cachedList);
+    assertNotSame(cachedList, local.<Object>call("echo", list).get());
+  }
+
+  @Test
+  public void memoization() throws Exception
+  {
+    QiService reply = new ReplyService();
+    DynamicObjectBuilder ob = new DynamicObjectBuilder();
+    ob.advertiseMethod("setStored::v(i)", reply, "Set stored value");
+    ob.advertiseMethod("waitAndAddToStored::i(ii)", reply, "Wait given time, and return stored + val",
+                       new MethodOptions().setMemoization(60000, 16));
+    ob.advertiseMethod("echo::m(m)", reply, "Return given value", new MethodOptions().setMemoization(60000, 16));
+    assertTrue("Service must be registered", s.registerService("serviceTestMemo", ob.object()) > 0);
+
+    AnyObject proxymemo = client.service("serviceTestMemo");
+    assertEquals(new Integer(1), proxymemo.<Integer>call("waitAndAddToStored", 0, 1).get());
+    proxymemo.<Void>call("setStored", 42).get();
+    // Same arguments: served from cache, Java is not called.
+    assertEquals(new Integer(1), proxymemo.<Integer>call("waitAndAddToStored", 0, 1).get());
+    assertEquals(new Integer(44), proxymemo.<Integer>call("waitAndAddToStored", 0, 2).get());
+
+    // Memoized Java objects are not shared between callers in this JVM.
+    AnyObject local = s.service("serviceTestMemo");
+    ArrayList<Integer> list = new ArrayList<Integer>();
+    list.add(42);
+    local.<Object>call("echo", list).get();
+    Object memoized = local.<Object>call("echo", list).get();
+    assertEquals(list, memoized);
+    assertNotSame(list, memoized);
+    assertNotSame(memoized, local.<Object>call("echo", list).get());
+  }
+
+  @Test
+  public void primitiveCall() throws Exception
+  {
+    assertEquals(new Integer(42), proxy.<Integer>callIntInt("addPrimitive", 40, 2).get());
+    assertEquals(new Integer(42), proxy.<Integer>callInt("answer", 41).get());
+    assertEquals(new Float(43), proxy.<Float>callFloat("answerFloat", 42.0f).get());
+    assertEquals(false, proxy.<Boolean>callBoolean("answerBool", true).get());
+    assertEquals("plafbim !", proxy.<String>callString("reply", "plaf").get());
+
+    // Other arguments keep going through call(String, Object...).
+    long value = 41;
+    assertEquals(new Integer(42), proxy.<Integer>call("answer", value).get());
+  }
+
+  @Test
+  public void cancellable() throws Exception
+  {
+    assertFalse(QiContext.isCancelled());
+    // Not canceled: runs until timeout.
+    assertEquals(false, proxy.<Boolean>call("waitForCancel", 50).get());
+
+    // Canceled: the method sees the request through QiContext and returns early.
+    ReplyService reply = new ReplyService();
+    DynamicObjectBuilder ob = new DynamicObjectBuilder();
+    ob.advertiseMethod("waitForCancel::b(i)", reply, "Wait until call is canceled",
+                       new MethodOptions().setCancellable(true));
+    AnyObject local = ob.object();
+
+    Future<Boolean> fut = local.<Boolean>call("waitForCancel", 5000);
+    Thread.sleep(100);
+    assertTrue(fut.cancel());
+    long end = System.currentTimeMillis() + 2000;
+    while (reply.cancelCount == 0 && System.currentTimeMillis() < end)
+      Thread.sleep(10);
+    assertEquals(1, reply.cancelCount);
+    assertTrue(fut.isCancelled());
+
+    // Waiting in Java does not change how cancellation is reported.
+    fut = local.<Boolean>call("waitForCancel", 5000).setManagedWait(true);
+    Thread.sleep(100);
+    assertTrue(fut.cancel());
+    try
+    {
+      fut.get();
+      fail("A canceled future has no value");
+    } catch (InterruptedException e)
+    {
+    }
+  }
+
+  @Test
+  public void cancelRemoteCall() throws Exception
+  {
+    ReplyService reply = new ReplyService();
+    DynamicObjectBuilder ob = new DynamicObjectBuilder();
+    ob.advertiseMethod("waitForCancel::b(i)", reply, "Wait until call is canceled",
+                       new MethodOptions().setCancellable(true));
+    assertTrue("Service must be registered", s.registerService("serviceTestCancel", ob.object()) > 0);
+
+    AnyObject proxyc = client.service("serviceTestCancel");
+    Future<Boolean> fut = proxyc.<Boolean>call("waitForCancel", 5000);
+    Thread.sleep(100);
+    assertTrue(fut.cancel());
+
+    // The service method sees the cancel request long before its timeout.
+    long end = System.currentTimeMillis() + 2000;
+    while (reply.cancelCount == 0 && System.currentTimeMillis() < end)
+      Thread.sleep(10);
+    assertEquals(1, reply.cancelCount);
+  }
+
+  @Test
+  public void batching() throws Exception
+  {
+    ReplyService reply = new ReplyService();
+    DynamicObjectBuilder ob = new DynamicObjectBuilder();
+    ob.advertiseMethod("reply::s(s)", reply, "Concatenate given argument with 'bim !'",
+                       new MethodOptions().setBatching("replyBatch", 0));
+    assertTrue("Service must be registered", s.registerService("serviceTestBatch", ob.object()) > 0);
+
+    AnyObject proxyb = client.service("serviceTestBatch");
+    java.util.ArrayList<Future<String>> replies = new java.util.ArrayList<Future<String>>();
+    for (int i = 0; i < 20; ++i)
+      replies.add(proxyb.<String>call("reply", "plaf" + i));
+    for (int i = 0; i < 20; ++i)
+      assertEquals("plaf" + i + "bim !", replies.get(i).get());
+    // Calls queued while a batch is handled are delivered together.
+    assertTrue(reply.batchCount < 20);
+  }
+
+  @Test
+  public void pipeline() throws Exception
+  {
+    Pipeline p = new Pipeline();
+    Pipeline.Result answer = p.call(proxy, "answer", 41);
+    p.call(proxy, "add", answer, 1, 2);
+    assertEquals(new Integer(45), p.<Integer>run().get());
+
+    Pipeline po = new Pipeline();
+    Pipeline.Result ro = po.call(proxy, "createObject");
+    po.property(ro, "uid");
+    assertEquals(new Integer(42), po.<Integer>run().get());
+
+    // A canceled pipeline starts no more steps.
+    Pipeline pc = new Pipeline();
+    pc.call(proxy, "waitAndAddToStored", 300, 1);
+    pc.call(proxy, "setStored", 42);
+    Future<Void> fut = pc.<Void>run();
+    Thread.sleep(100);
+    fut.cancel();
+    fut.sync();
+    assertTrue(fut.isCancelled());
+    assertEquals(new Integer(0), proxy.<Integer>call("waitAndAddToStored", 0, 0).get());
+  }
+
+  @Test
+  public void callTimeout() throws Exception
+  {
+    try {
+      proxyts.<Integer>callWithTimeout(100, "waitAndAddToStored", 1000, 1).get();
+      fail("Call past its deadline must fail");
+    } catch (CallTimeoutError e) {
+      assertEquals("Call timed out", e.getMessage());
+    }
+    assertEquals(new Integer(1), proxyts.<Integer>callWithTimeout(1000, "waitAndAddToStored", 0, 1).get());
+  }
+
+  @Test
+  public void methodDeadline() throws Exception
+  {
+    ReplyService reply = new ReplyService();
+    DynamicObjectBuilder ob = new DynamicObjectBuilder();
+    ob.advertiseMethod("waitForCancel::b(i)", reply, "Wait for a cancel request",
+                       new MethodOptions().setDeadline(100));
+    assertTrue("Service must be registered", s.registerService("serviceTestDeadline", ob.object()) > 0);
+
+    AnyObject proxyd = client.service("serviceTestDeadline");
+    try {
+      proxyd.<Boolean>call("waitForCancel", 5000).get();
+      fail("Call past its deadline must fail");
+    } catch (CallError e) {
+      assertEquals("Call deadline exceeded", e.getMessage());
+    }
+  }
+
+  @Test
+  public void methodConcurrency() throws Exception
+  {
+    // Two calls of meet meet only if they run at the same time.
+    ReplyService reply = new ReplyService();
+    AnyObject concurrent = meetingService("serviceTestConcurrent", reply,
+                                          new MethodOptions().setConcurrency(MethodOptions.Concurrency.Concurrent));
+    assertEquals(2, meetings(reply, concurrent, 1, 1));
+
+    // Exclusive call runs alone
+    AnyObject exclusive = meetingService("serviceTestExclusive", reply,
+                                         new MethodOptions().setConcurrency(MethodOptions.Concurrency.Exclusive));
+    assertEquals(1, meetings(reply, exclusive, 1, 2));
+
+    // Strand calls overlap unless they have the same key
+    AnyObject strand = meetingService("serviceTestStrand", reply, new MethodOptions().setStrand(0));
+    assertEquals(1, meetings(reply, strand, 1, 1));
+    assertEquals(2, meetings(reply, strand, 1, 2));
+  }
+
+  private AnyObject meetingService(String name, ReplyService reply, MethodOptions options) throws Exception
+  {
+    DynamicObjectBuilder ob = new DynamicObjectBuilder();
+    ob.advertiseMethod("meet::b(ii)", reply, "Wait for another call of meet", options);
+    assertTrue("Service must be registered", s.registerService(name, ob.object()) > 0);
+    return client.service(name);
+  }
+
+  /// Number of two calls of meet with given keys that met another call
+  private int meetings(ReplyService reply, AnyObject proxy, int key0, int key1) throws Exception
+  {
+    reply.resetMeeting();
+    Future<Boolean> v0 = proxy.<Boolean>call("meet", key0, 500);
+    Future<Boolean> v1 = proxy.<Boolean>call("meet", key1, 500);
+    return (v0.get() ? 1 : 0) + (v1.get() ? 1 : 0);
+  }
+
+  @Test
+  public void callLimits() throws Exception
+  {
+    proxyts.setCallLimits(1, 0, OverflowPolicy.FailFast);
+    Future<Integer> v0 = proxyts.<Integer>call("waitAndAddToStored", 300, 1);
+    Future<Integer> v1 = proxyts.<Integer>call("waitAndAddToStored", 0, 2);
+    try {
+      v1.get();
+      fail("Call beyond limits must fail");
+    } catch (CallError e) {
+      assertEquals("Call rejected: too many calls in flight", e.getMessage());
+    }
+    assertEquals(new Integer(1), v0.get());
+    assertEquals(1, proxyts.callCounters().getRejected());
+
+    proxyts.setCallLimits(1, 0, OverflowPolicy.DropOldest);
+    v0 = proxyts.<Integer>call("waitAndAddToStored", 300, 1);
+    v1 = proxyts.<Integer>call("waitAndAddToStored", 0, 2);
+    assertEquals(new Integer(2), v1.get());
+    try {
+      v0.get();
+      fail("Dropped call must fail");
+    } catch (CallError e) {
+    }
+    assertEquals(1, proxyts.callCounters().getDropped());
+
+    // Dropped call is canceled too.
+    ReplyService reply = new ReplyService();
+    DynamicObjectBuilder ob = new DynamicObjectBuilder();
+    ob.advertiseMethod("waitForCancel::b(i)", reply, "Wait until call is canceled",
+                       new MethodOptions().setCancellable(true));
+    assertTrue("Service must be registered", s.registerService("serviceTestDrop", ob.object()) > 0);
+    AnyObject proxyc = client.service("serviceTestDrop");
+    proxyc.setCallLimits(1, 0, OverflowPolicy.DropOldest);
+    Future<Boolean> w0 = proxyc.<Boolean>call("waitForCancel", 5000);
+    Thread.sleep(100);
+    assertEquals(false, proxyc.<Boolean>call("waitForCancel", 0).get());
+    long end = System.currentTimeMillis() + 2000;
+    while (reply.cancelCount == 0 && System.currentTimeMillis() < end)
+      Thread.sleep(10);
+    assertEquals(1, reply.cancelCount);
+    try {
+      w0.get();
+      fail("Dropped call must fail");
+    } catch (CallError e) {
+    }
+  }
+
+  @Test
+  public void localCall() throws Exception
+  {
+    // Same session: caller and service live in this JVM.
+    AnyObject local = s.service("serviceTest");
+    assertNotNull(local);
+
+    assertEquals("plafbim !", local.<String>call("reply", "plaf").get());
+    assertEquals(new Integer(42), local.<Integer>call("add", 40, 1, 1).get());
+    assertEquals(new Float(43), local.<Float>call("answerFloat", 42.0f).get());
+
+    // Java objects are passed through for a caller in this JVM only.
+    ArrayList<Integer> list = new ArrayList<Integer>();
+    list.add(42);
+    assertSame(list, local.<Object>call("echo", list).get());
+    Object remote = proxy.<Object>call("echo", list).get();
+    assertEquals(list, remote);
+    assertNotSame(list, remote);
+  }
+
   @Test
   public void getObject()
   {
@@ -8,15 +8,25 @@ import java.util.ArrayList;
 import java.util.Hashtable;
 import java.util.Iterator;
 import java.util.Map;
+import java.util.concurrent.CountDownLatch;
+import java.util.concurrent.TimeUnit;
 
 public class ReplyService extends QiService
 {
   private int storedValue = 0;
+  public int batchCount = 0;
+  public volatile int cancelCount = 0;
+  private volatile CountDownLatch meeting = new CountDownLatch(2);
   public Boolean iWillThrow() throws Exception
   {
     throw new Exception("Expected Failure");
   }
 
+  public Boolean throwMessage(String message) throws Exception
+  {
+    throw new Exception(message);
+  }
+
   public Boolean generic(Object obj)
   {
     if (obj == null)
@@ -26,6 +36,11 @@ public class ReplyService extends QiService
     return true;
   }
 
+  public Object echo(Object obj)
+  {
+    return obj;
+  }
+
   public AnyObject createObject()
   {
     DynamicObjectBuilder ob = new DynamicObjectBuilder();
@@ -90,6 +105,24 @@ public class ReplyService extends QiService
     return str.concat("bim !");
   }
 
+  public Future<String> asyncReply(final String str)
+  {
+    final Promise<String> promise = new Promise<String>();
+
+    new Thread(new Runnable() {
+      public void run()
+      {
+        try
+        {
+          Thread.sleep(200);
+        } catch (InterruptedException e) {}
+        promise.setValue(str.concat("bim !"));
+      }
+    }).start();
+
+    return promise.getFuture();
+  }
+
   public String answer()
   {
     return "42 !";
@@ -101,6 +134,41 @@ public class ReplyService extends QiService
     return val + 1;
   }
 
+  public Boolean waitForCancel(Integer msTimeout)
+  {
+    long end = System.currentTimeMillis() + msTimeout;
+    while (System.currentTimeMillis() < end)
+    {
+      if (QiContext.isCancelled())
+      {
+        ++cancelCount;
+        return true;
+      }
+      try {
+        Thread.sleep(10);
+      } catch(Exception e) {}
+    }
+    return false;
+  }
+
+  /// Wait for another call of meet, return false if none is running before timeout
+  public Boolean meet(Integer key, Integer msTimeout) throws InterruptedException
+  {
+    CountDownLatch m = meeting;
+    m.countDown();
+    return m.await(msTimeout, TimeUnit.MILLISECONDS);
+  }
+
+  public void resetMeeting()
+  {
+    meeting = new CountDownLatch(2);
+  }
+
+  public int addPrimitive(int a, int b)
+  {
+    return a + b;
+  }
+
   public Float   answerFloat(Float val)
   {
     return val + 1f;
@@ -175,4 +243,15 @@ public class ReplyService extends QiService
     } catch(Exception e) {}
     return v + storedValue;
   }
+  public Object[] replyBatch(Object[][] calls)
+  {
+    ++batchCount;
+    Object[] results = new Object[calls.length];
+    for (int i = 0; i < calls.length; ++i)
+      results[i] = calls[i][0] + "bim !";
+    try {
+      Thread.sleep(50);
+    } catch(Exception e) {}
+    return results;
+  }
 }